@@ -1,168 +1,417 @@
 
 #include "btetris_control.h"
+#include "btetris_publish.h"
 #include "tdraw.h"
+#include "trender.h"
+#include "tvt.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
-#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
 
 tetris_board_t _board;
 tetris_game_t _game;
+trender_t _render;
 
-int main()
+// Tick timing of the simulation loop, reported on exit
+typedef struct tick_stats {
+    int8_t      split;      // Set if drawing runs on the render thread
+    uint64_t    ticks;      // Ticks with a measured interval
+    uint64_t    jsum;       // Sum of tick jitter in microseconds
+    uint64_t    jmax;       // Largest tick jitter in microseconds
+    uint64_t    missed;     // Tick periods that passed without a tick, the next tick's time covers them
+} tick_stats_t;
+
+tick_stats_t _stats;
+
+// Shared memory object frames are published to, NULL if not publishing
+const char* _pubname;
+
+// Prints tick jitter and render counts, the menus exit from inside ncurses so this runs from atexit
+void tick_report()
+{
+    fprintf(stderr, "%s: %lu ticks (%lu missed), jitter mean %.0f us max %lu us, %lu frames submitted, %lu drawn\n",
+        _stats.split ? "render thread" : "single thread", (unsigned long)_stats.ticks, (unsigned long)_stats.missed,
+        _stats.ticks ? (double)_stats.jsum / _stats.ticks : 0.0, (unsigned long)_stats.jmax,
+        (unsigned long)_render.submitted, (unsigned long)atomic_load(&_render.drawn));
+}
+
+// Gets monotonic time in microseconds, wall clock changes don't affect game time
+uint64_t now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Arms a timerfd to first expire at an absolute monotonic time in microseconds, then every period microseconds
+void timer_arm(int tfd, uint64_t t, uint64_t period)
+{
+    struct itimerspec its = {
+        .it_interval = {(time_t)(period / 1000000), (long)(period % 1000000) * 1000},
+        .it_value = {(time_t)(t / 1000000), (long)(t % 1000000) * 1000}
+    };
+
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// Hands a snapshot of the game to the renderer, which draws it on its own thread unless running single threaded
+void frame_submit(tetris_game_t* game)
+{
+    tdraw_snapshot(trender_back(&_render), game);
+    trender_back(&_render)->jitter = _stats.ticks ? _stats.jsum / _stats.ticks : 0;
+    trender_back(&_render)->jitter_max = _stats.jmax;
+    trender_submit(&_render);
+    if (!_stats.split) {
+        trender_draw(&_render);
+    }
+}
+
+// Removes the shared memory object on exit, readers that still have it mapped keep their mapping
+void pub_unlink()
+{
+    if (_pubname) {
+        shm_unlink(_pubname);
+    }
+}
+
+// Maps a shared memory object holding a publication, see btetris_publish.h
+tetris_pub_t* pub_open(const char* name)
+{
+    tetris_pub_t* pub;
+    int fd;
+
+    fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(tetris_pub_t)) < 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    pub = mmap(NULL, sizeof(tetris_pub_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pub == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return NULL;
+    }
+    tetris_pub_init(pub);
+
+    return pub;
+}
+
+int main(int argc, char** argv)
 {
     // Pointer to globaly allocated game objects
     tetris_board_t* board = &_board;
     tetris_game_t* game = &_game;
+    trender_t* render = &_render;
+    tick_stats_t* stats = &_stats;
 
-    // itits screen. sets up memory and clears screen
-    initscr();
-    noecho();
-    keypad(stdscr, true);
-    nodelay(stdscr, true);
-
-    // Refreshes screen to match whats in buffer
-    refresh();
-
-    // Init UI windows
-    tdraw_wininit();
-    tdraw_initcolor();
+    // Frames are published to shared memory for other processes with `tetrisd -p /name`,
+    // `tetrisd -s` draws on the simulation thread instead of a render thread,
+    // `tetrisd -v` draws with escape sequences instead of ncurses
+    tetris_pub_t* pub = NULL;
+    int vt = 0;
+    stats->split = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0) {
+            stats->split = 0;
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            vt = 1;
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            pub = pub_open(argv[++i]);
+            if (!pub)
+            {
+                perror("shm_open");
+                return 1;
+            }
+            _pubname = argv[i];
+            atexit(pub_unlink);
+        }
+    }
 
     // Init tetris game objects
     tetris_init(game, board, rand());
+    atexit(tick_report);
+
+    // Escape sequence backend has no menus, the game starts right away
+    if (vt)
+    {
+        if (tvt_init() != SUCCESS)
+        {
+            fprintf(stderr, "stdin is not a terminal\n");
+            return 1;
+        }
+        atexit(tvt_end);
+        tetris_start(game);
+    }
+    else
+    {
+        // itits screen. sets up memory and clears screen
+        initscr();
+        noecho();
+        keypad(stdscr, true);
+        nodelay(stdscr, true);
+
+        // Refreshes screen to match whats in buffer
+        refresh();
 
-    // Open start menu
-    tdraw_start(game);
+        // Init UI windows
+        tdraw_wininit();
+        tdraw_initcolor();
+
+        // Open start menu
+        tdraw_start(game);
+    }
+
+    // Drawing moves to its own thread from here on, the simulation only hands it snapshots
+    trender_init(render, vt ? tvt_frame : tdraw_frame);
+    if (stats->split && trender_start(render) != SUCCESS)
+    {
+        if (!vt) {
+            endwin();
+        }
+        fprintf(stderr, "failed to start render thread\n");
+        return 1;
+    }
+
+    // Ticks are driven by a timer on the monotonic clock, keys wake the loop as soon as they arrive
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0)
+    {
+        perror("timerfd_create");
+        exit(1);
+    }
+    struct pollfd fds[2] = {
+        {.fd = STDIN_FILENO, .events = POLLIN},
+        {.fd = tfd, .events = POLLIN}
+    };
 
     // Init time info
     int ch;
-    struct timeval tstruct;
-    uint64_t trefresh = 0;
-    uint64_t tprev = 0;
-    uint64_t tnow = 0;
-    gettimeofday(&tstruct, NULL);
-    tnow =      (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
-    tprev =     (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
-    trefresh =  (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
-
-    // Main keypress loop 
+    int keys[64];           // Keys drained in one wakeup
+    int nkeys;
+    int busy = 0;           // Renderer held ncurses during the last wakeup, input is retried shortly
+    int quit = 0;           // Set by Ctrl-C in the escape sequence backend, ncurses menus exit on their own
+    int woken;
+    uint64_t expired;       // Tick periods since the timer was last read
+    uint64_t tnow = now_us();
+    uint64_t tprev = tnow;
+    uint64_t tlast = 0;     // Previous tick, 0 after a menu so its interval isn't counted as jitter
+    timer_arm(tfd, tnow + 1000000/100, 1000000/100);
+
+    // Main loop, sleeps until a key or the next tick
     tetris_error_t tick_result;
-    while(true)
+    while (!quit)
     {
-        // Get keypress
-        ch = getch();
-
-        if (ch != ERR) {
-            // Output char for debug info
-            if (debug_window) {
-                wprintw(debug_window, "%s\n", keyname(ch));
-                wrefresh(debug_window);
+        // Signals such as SIGWINCH interrupt the wait and are picked up as keys by ncurses
+        fds[0].fd = busy ? -1 : STDIN_FILENO;
+        woken = poll(fds, 2, busy ? 1 : -1);
+        if (woken < 0 && errno != EINTR)
+        {
+            perror("poll");
+            exit(1);
+        }
+
+        // Drain every pending key. Input waits while the renderer draws, so a slow terminal never stalls ticks.
+        nkeys = 0;
+        if (busy || woken < 0 || (fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+            busy = 0;
+            if (vt)
+            {
+                while (nkeys < 64 && (ch = tvt_getch()) != ERR) {
+                    keys[nkeys++] = ch;
+                }
             }
+            else if (pthread_mutex_trylock(&render->lock) == 0)
+            {
+                while (nkeys < 64 && (ch = getch()) != ERR)
+                {
+                    keys[nkeys++] = ch;
+
+                    // Output char for debug info
+                    if (debug_window) {
+                        wprintw(debug_window, "%s\n", keyname(ch));
+                    }
+
+                    #ifdef KEY_RESIZE
+                    if (ch == KEY_RESIZE)
+                    {
+                        erase();
+                        tdraw_winupdate();
+                        tdraw_touchwin();
+                    }
+                    #endif
+                }
+                if (nkeys && debug_window) {
+                    wrefresh(debug_window);
+                }
+                pthread_mutex_unlock(&render->lock);
+            }
+            else {
+                busy = 1;
+            }
+        }
+
+        // Handle keypresses
+        for (int k = 0; k < nkeys; k++)
+        {
+            ch = keys[k];
 
             // Generate entropy from keypress
             tetris_rand_entropy(game, ch);
+
+            switch (ch)
+            {
+            case 's':
+            case 'S':
+            case KEY_DOWN:
+                tetris_sdrop(game);
+                break;
+
+            case 'a':
+            case 'A':
+            case KEY_LEFT:
+                tetris_leftshift(game);
+                break;
+
+            case 'd':
+            case 'D':
+            case KEY_RIGHT:
+                tetris_rightshift(game);
+                break;
+
+            case 'w':
+            case 'W':
+            case 'e':
+            case 'E':
+            case KEY_UP:
+                tetris_rotcw(game);
+                break;
+
+            case 'z':
+            case 'Z':
+            case 'q':
+            case 'Q':
+                tetris_rotcntrcw(game);
+                break;
+
+            case ' ':
+                tetris_hdrop(game);
+                break;
+
+            case 3:
+                // Ctrl-C quits the escape sequence backend, ncurses handles it as a signal
+                quit = 1;
+                break;
+
+            case 'p':
+            case 'P':
+            case 27:
+                // Escape sequence backend only toggles pause
+                if (vt)
+                {
+                    if (game->isRunning) {
+                        tetris_pause(game);
+                    }
+                    else {
+                        tetris_unpause(game);
+                    }
+                }
+                // Draw pause menu, the renderer waits until it closes
+                else
+                {
+                    pthread_mutex_lock(&render->lock);
+                    tdraw_pause(game);
+                    pthread_mutex_unlock(&render->lock);
+                }
+
+                // Reset stopwatch and tick schedule
+                tprev = now_us();
+                tlast = 0;
+                timer_arm(tfd, tprev + 1000000/100, 1000000/100);
+                break;
+            }
         }
 
-        // Handle keypress
-        switch (ch)
+        // Tick game 100 times a second. A loop that fell behind ticks once and counts the periods it missed,
+        // the tick's time still covers them so the game doesn't slow down.
+        if (!quit && woken > 0 && (fds[1].revents & POLLIN) && read(tfd, &expired, sizeof(expired)) == sizeof(expired))
         {
-        case ERR:
-            break;
-
-        #ifdef KEY_RESIZE
-        case KEY_RESIZE:
-            erase();
-            tdraw_winupdate();
-            tdraw_touchwin();
-            break;
-        #endif
-
-        case 's':
-        case 'S':
-        case KEY_DOWN:
-            tetris_sdrop(game);
-            break;
-
-        case 'a':
-        case 'A':
-        case KEY_LEFT:
-            tetris_leftshift(game);
-            break;
-
-        case 'd':
-        case 'D':
-        case KEY_RIGHT:
-            tetris_rightshift(game);
-            break;
-
-        case 'w':
-        case 'W':
-        case 'e':
-        case 'E':
-        case KEY_UP:
-            tetris_rotcw(game);
-            break;
-
-        case 'z':
-        case 'Z':
-        case 'q':
-        case 'Q':
-            tetris_rotcntrcw(game);
-            break;
-
-        case ' ':
-            tetris_hdrop(game);
-            break;
-
-        case 'p':
-        case 'P':
-        case 27:
-            // Draw pause menu
-            tdraw_pause(game);
-
-            // Reset stopwatch
-            gettimeofday(&tstruct, NULL);
-            tprev = (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
-            break;
-        }
+            tnow = now_us();
+            if (expired > 1) {
+                stats->missed += expired - 1;
+            }
 
-        // Get current time 
-        gettimeofday(&tstruct, NULL);
-        tnow = (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
+            // Jitter is how far this tick interval is from the 10ms period
+            if (tlast)
+            {
+                uint64_t jitter = (tnow - tlast > 10000) ? tnow - tlast - 10000 : 10000 - (tnow - tlast);
+                stats->ticks++;
+                stats->jsum += jitter;
+                if (jitter > stats->jmax) {
+                    stats->jmax = jitter;
+                }
+            }
+            tlast = tnow;
 
-        // Tick game 100 times a second
-        if (tnow - trefresh > 1000000/100 /*100hz*/)
-        {
             // Tick the game
-            trefresh = tnow;
             tick_result = tetris_tick(game, tnow - tprev);
+            if (pub) {
+                tetris_publish(pub, game);
+            }
+            frame_submit(game);
 
-            // Draw UI
-            tdraw_pfield(game);
-            tdraw_pprev(game);
-            tdraw_score(game);
-            tdraw_ginfo(game);
-            
             // Handle gameover
             if (tick_result == TETRIS_ERROR_GAME_OVER)
             {
-                // Draw gameover menu
-                tdraw_gameover(game);
-                
-                // Reset stopwatch after new game starts
-                gettimeofday(&tstruct, NULL);
-                tprev = (uint64_t)tstruct.tv_sec * 1000000 + (uint64_t)tstruct.tv_usec;
-            }
-            else 
-            {
-                tprev = tnow;
+                // Escape sequence backend starts over right away
+                if (vt)
+                {
+                    tetris_reset(game);
+                    tetris_start(game);
+                }
+                // Draw gameover menu, the renderer waits until it closes
+                else
+                {
+                    pthread_mutex_lock(&render->lock);
+                    tdraw_gameover(game);
+                    pthread_mutex_unlock(&render->lock);
+                }
+
+                // Reset stopwatch and tick schedule after new game starts
+                tnow = now_us();
+                tlast = 0;
+                timer_arm(tfd, tnow + 1000000/100, 1000000/100);
             }
+            tprev = tnow;
+        }
+        // Moves are shown right away instead of at the next tick
+        else if (nkeys) {
+            frame_submit(game);
         }
-        usleep(1000);
     }
 
-    // ends ncurse
-    getch();
-    endwin();
+    // Only the escape sequence backend leaves the loop, tvt_end() restores the terminal from atexit
+    trender_stop(render);
+    close(tfd);
 
     return 0;
 }
\ No newline at end of file
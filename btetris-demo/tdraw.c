@@ -1,4 +1,6 @@
 #include "tdraw.h"
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -29,6 +31,16 @@
 #define TDRAW_GINFO_XOFFSET (TDRAW_GINFO_WWIDTH)
 #define TDRAW_GINFO_YOFFSET (TDRAW_GINFO_WHEIGHT)
 
+// Windows that are fully redrawn by the next frame, see shadow_stale
+#define TDRAW_STALE_PFIELD 1
+#define TDRAW_STALE_PPREV 2
+#define TDRAW_STALE_SCORE 4
+#define TDRAW_STALE_GINFO 8
+#define TDRAW_STALE_ALL 15
+
+// Playfield cell above pf_height, left erased instead of drawn as a blank block
+#define TDRAW_ERASED 0xFF
+
 
 typedef union tdraw_coord {
     uint32_t isRendered;
@@ -68,6 +80,11 @@ WINDOW* windebug;
 WINDOW* winginfo;
 WINDOW* debug_window;
 
+// Last frame drawn into the game windows, only what differs from it is drawn again
+tdraw_frame_t shadow;
+uint8_t shadow_pf[TETRIS_HEIGHT][TETRIS_WIDTH];     // Playfield as drawn, falling tetromino included
+int shadow_stale = TDRAW_STALE_ALL;                 // Windows whose content doesn't match the shadow frame
+
 
 // --- Private Functions --- //
 
@@ -85,6 +102,14 @@ tdraw_winoff_t tdraw_calc_offsets();
 /// @return Error value
 int tdraw_keybinds();
 
+/// @brief Prints a text field and clears the rest of its line up to the window border
+/// @param window Window to print to
+/// @param y Line
+/// @param x Column
+/// @param fmt printf format
+/// @return Error value
+int tdraw_field(WINDOW* window, int y, int x, const char* fmt, ...);
+
 int tdraw_block(WINDOW* window, tetris_color_t bcolor)
 {
     chtype solid_block; // Character used to display pixel
@@ -127,6 +152,32 @@ int tdraw_block(WINDOW* window, tetris_color_t bcolor)
     return retval;
 }
 
+int tdraw_field(WINDOW* window, int y, int x, const char* fmt, ...)
+{
+    char text[64];
+    int width;
+    va_list args;
+
+    if (!window) {
+        return ERROR_NULL_INARG;
+    }
+
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    // Pad with spaces so a shorter value overwrites a longer one, the border column is left alone
+    width = getmaxx(window) - 1 - x;
+    if (width < 0) {
+        width = 0;
+    }
+    if (mvwprintw(window, y, x, "%-*.*s", width, width, text) == ERR) {
+        return ERROR_NCURSES_PRINT;
+    }
+
+    return SUCCESS;
+}
+
 tdraw_winoff_t tdraw_calc_offsets()
 {
     int c_height, c_width;      // Console width and height
@@ -969,56 +1020,109 @@ int tdraw_title()
     return SUCCESS;
 }
 
-int tdraw_pfield(tetris_game_t* game)
+int tdraw_snapshot(tdraw_frame_t* frame, tetris_game_t* game)
 {
     // Input arg check
-    if (!game) {
+    if (!frame || !game || !game->board) {
+        return ERROR_NULL_INARG;
+    }
+
+    // Board internals are read before the frame copy updates the ghost piece cache
+    frame->frot = game->board->frot;
+    frame->gc_valid = game->board->gc_valid;
+    tetris_frame_copy(&frame->game, game);
+
+    frame->bag_idx = tetris_bag_tell(&game->bag);
+    memcpy(frame->bag, game->bag.bag, sizeof(frame->bag));
+    for (int i = 0; i < 10; i++)
+    {
+        frame->next[i] = tetris_bag_get(&game->bag, frame->bag_idx + i);
+    }
+    frame->rng = game->rng.s[0];
+    frame->gacc = game->gacc;
+
+    return SUCCESS;
+}
+
+int tdraw_pfield(const tdraw_frame_t* frame)
+{
+    const tetris_frame_t* game;
+    uint8_t view[TETRIS_HEIGHT][TETRIS_WIDTH];  // Playfield as it is shown
+    int full, changed = 0;
+
+    // Input arg check
+    if (!frame) {
         return ERROR_NULL_INARG;
     }
     if (!winpfield) {
         return ERROR_NULL_GVAR;
     }
+    game = &frame->game;
+    full = shadow_stale & TDRAW_STALE_PFIELD;
 
-    // Clear playfield window
-    werase(winpfield);
-
-    // Draw tetris playfield array
-    for (int y = game->board->pf_height; y >= 0; y--)
+    // Compose the playfield, rows above pf_height are left erased
+    memset(view, TDRAW_ERASED, sizeof(view));
+    for (int y = 0; y <= game->pf_height && y < TETRIS_HEIGHT; y++)
     {
-        // Move cursor to row position
-        wmove(winpfield, TETRIS_HEIGHT - y, 1);
-        for (int x = 0; x < TETRIS_WIDTH; x++)
-        {
-            tdraw_block(winpfield, game->board->pf[y][x]);
-        }
+        memcpy(view[y], game->pf[y], TETRIS_WIDTH);
     }
 
-    // Draw falling tetromino
+    // Add falling tetromino
     for (int i = 0; i < 4; i++)
     {
         // Skip if out of bounds
-        if (0 > game->board->fpos[i].h || game->board->fpos[i].h >= TETRIS_HEIGHT || 
-            0 > game->board->fpos[i].w || game->board->fpos[i].w >= TETRIS_WIDTH) {
+        if (0 > game->fpos[i].h || game->fpos[i].h >= TETRIS_HEIGHT || 
+            0 > game->fpos[i].w || game->fpos[i].w >= TETRIS_WIDTH) {
             continue;
         }
+        view[game->fpos[i].h][game->fpos[i].w] = game->fcol;
+    }
+
+    // Clear playfield window if it has to be redrawn
+    if (full)
+    {
+        werase(winpfield);
+        box(winpfield, 0, 0);
+        memset(shadow_pf, TDRAW_ERASED, sizeof(shadow_pf));
+        changed = 1;
+    }
 
-        // Draw block
-        wmove(winpfield, TETRIS_HEIGHT - game->board->fpos[i].h, game->board->fpos[i].w*2 + 1);
-        tdraw_block(winpfield, game->board->fcol);
+    // Draw cells that changed since the last frame
+    for (int y = 0; y < TETRIS_HEIGHT; y++)
+    {
+        for (int x = 0; x < TETRIS_WIDTH; x++)
+        {
+            if (view[y][x] == shadow_pf[y][x]) {
+                continue;
+            }
+
+            wmove(winpfield, TETRIS_HEIGHT - y, x*2 + 1);
+            if (view[y][x] == TDRAW_ERASED) {
+                waddstr(winpfield, "  ");
+            }
+            else {
+                tdraw_block(winpfield, view[y][x]);
+            }
+            changed = 1;
+        }
     }
+    memcpy(shadow_pf, view, sizeof(view));
+    shadow_stale &= ~TDRAW_STALE_PFIELD;
 
-    // Reset cursor and refresh window
-    wmove(winpfield, 1, 1);
-    box(winpfield, 0, 0);
-    wrefresh(winpfield);
+    // Reset cursor and queue window for the next update
+    if (changed)
+    {
+        wmove(winpfield, 1, 1);
+        wnoutrefresh(winpfield);
+    }
 
     return SUCCESS;
 }
 
-int tdraw_pprev(tetris_game_t* game)
+int tdraw_pprev(const tdraw_frame_t* frame)
 {
     // Input arg check
-    if (!game) {
+    if (!frame) {
         return ERROR_NULL_INARG;
     }
     if (!winpprev) {
@@ -1032,24 +1136,41 @@ int tdraw_pprev(tetris_game_t* game)
 
     char isOddWidth;            // True of tetromino has an odd width
     tetris_coord_t tmp_coord; 
+    tetris_color_t pcolor;      // Color of current piece preview tetromino
+    int full = shadow_stale & TDRAW_STALE_PPREV;
+    int changed = full;
 
-    // Clear piece preview window
-    werase(winpprev);
-
-    // Add separator bar to window
-    for (int i = 1; i < 5; i++)
+    // Clear piece preview window and add separator bar if it has to be redrawn
+    if (full)
     {
-        mvwaddch(winpprev, i, 9, '|');
+        werase(winpprev);
+        for (int i = 1; i < 5; i++)
+        {
+            mvwaddch(winpprev, i, 9, '|');
+        }
+        box(winpprev, 0, 0);
     }
 
-    // Loop through pieces in piece preview 
+    // Loop through pieces in piece preview, only slots that changed are drawn
     for (int ppi = 0; ppi < TETRIS_PP_SIZE; ppi++)
     {
-        if (game->ppreview[ppi] == TETRIS_BLANK) {
+        pcolor = frame->game.ppreview[ppi];
+        if (!full && pcolor == shadow.game.ppreview[ppi]) {
             continue;
         }
+        shadow.game.ppreview[ppi] = pcolor;
+        changed = 1;
 
-        if (game->ppreview[ppi] > 2) {
+        // Clear slot
+        for (int i = 1; i < 5; i++)
+        {
+            mvwaddstr(winpprev, i, ppi * 9 + 1, "        ");
+        }
+        if (pcolor == TETRIS_BLANK) {
+            continue;
+        }
+
+        if (pcolor > 2) {
             isOddWidth = 1;
         }
         else {
@@ -1059,94 +1180,188 @@ int tdraw_pprev(tetris_game_t* game)
         // Loop through blocks for a piece in piece preview
         for (int ppj = 0; ppj < 4; ppj++)
         {
-            tmp_coord = tetris_subCoord(TETRIS_TETROMINO_START[game->ppreview[ppi]][ppj], PPOFFSET);
+            tmp_coord = tetris_subCoord(TETRIS_TETROMINO_START[pcolor][ppj], PPOFFSET);
             tmp_coord.h = 3 - tmp_coord.h;
 
             wmove(winpprev, tmp_coord.h + 1, tmp_coord.w*2 + ppi * 9 + isOddWidth + 1);
-            tdraw_block(winpprev, game->ppreview[ppi]);
+            tdraw_block(winpprev, pcolor);
         }
     }
+    shadow_stale &= ~TDRAW_STALE_PPREV;
 
-    // Draw border and refresh window
-    box(winpprev, 0, 0);
-    wrefresh(winpprev);
+    // Queue window for the next update
+    if (changed) {
+        wnoutrefresh(winpprev);
+    }
 
     return SUCCESS;
 }
 
-int tdraw_score(tetris_game_t* game)
+int tdraw_score(const tdraw_frame_t* frame)
 {
+    int full = shadow_stale & TDRAW_STALE_SCORE;
+    int changed = full;
+
     // Input arg check
-    if (!game) {
+    if (!frame) {
         return ERROR_NULL_INARG;
     }
     if (!winscore) {
         return ERROR_NULL_GVAR;
     }
 
-    // Draw score and level info
-    mvwprintw(winscore, 1, 1, "Score: %ld", game->score);
-    wclrtoeol(winscore);
-    mvwprintw(winscore, 2, 1, "Level: %d", game->level);
-    wclrtoeol(winscore);
+    // Draw score and level info that changed
+    if (full) {
+        box(winscore, 0, 0);
+    }
+    if (full || frame->game.score != shadow.game.score)
+    {
+        tdraw_field(winscore, 1, 1, "Score: %ld", (long)frame->game.score);
+        shadow.game.score = frame->game.score;
+        changed = 1;
+    }
+    if (full || frame->game.level != shadow.game.level)
+    {
+        tdraw_field(winscore, 2, 1, "Level: %d", frame->game.level);
+        shadow.game.level = frame->game.level;
+        changed = 1;
+    }
+    shadow_stale &= ~TDRAW_STALE_SCORE;
 
-    // Draw border and refresh window
-    box(winscore, 0, 0);
-    wrefresh(winscore);
+    // Queue window for the next update
+    if (changed) {
+        wnoutrefresh(winscore);
+    }
 
     return SUCCESS;
 }
 
-int tdraw_ginfo(tetris_game_t* game)
+int tdraw_ginfo(const tdraw_frame_t* frame)
 {
+    const tetris_frame_t* game;
+    int full;
+
     // Input arg check
-    if (!game) {
+    if (!frame) {
         return ERROR_NULL_INARG;
     }
     if (!win_offsets.ginfo.isRendered) {
         return ERROR_NULL_GVAR;
     }
+    game = &frame->game;
+    full = shadow_stale & TDRAW_STALE_GINFO;
 
-    // Erase window and redraw border
-    werase(winginfo);
-    box(winginfo, 0, 0);
+    // Labels and border are only drawn when the window has to be redrawn
+    if (full)
+    {
+        werase(winginfo);
+        box(winginfo, 0, 0);
+        mvwprintw(winginfo, 1, 1, "tetris_game: state");
+        mvwprintw(winginfo, 5, 1, "tetris_game: score");
+        mvwprintw(winginfo, 8, 1, "tetris_game: tetromino bag");
+        mvwprintw(winginfo, 10, 3, "bag: ");
+        mvwprintw(winginfo, 11, 3, "next: ");
+        mvwprintw(winginfo, 13, 1, "tetris_game: time");
+        mvwprintw(winginfo, 17, 1, "tetris_board:");
+        mvwprintw(winginfo, 18, 3, "falling color: ");
+    }
 
-    // --- Print Debug Information --- //
+    // --- Print Debug Information that changed --- //
 
-    mvwprintw(winginfo, 1, 1, "tetris_game: state");
-    mvwprintw(winginfo, 2, 3, "Started: %s", game->isStarted ? "true" : "false");
-    mvwprintw(winginfo, 3, 3, "Running: %s", game->isRunning ? "true" : "false");
-    mvwprintw(winginfo, 4, 3, "Gameover: %s", game->isGameover ? "true" : "false");
+    if (full || game->flags != shadow.game.flags)
+    {
+        tdraw_field(winginfo, 2, 3, "Started: %s", (game->flags & 1) ? "true" : "false");
+        tdraw_field(winginfo, 3, 3, "Running: %s", (game->flags & 2) ? "true" : "false");
+        tdraw_field(winginfo, 4, 3, "Gameover: %s", (game->flags & 4) ? "true" : "false");
+    }
 
-    mvwprintw(winginfo, 5, 1, "tetris_game: score");
-    mvwprintw(winginfo, 6, 3, "combo: %d", game->combo);
-    mvwprintw(winginfo, 7, 3, "lines: %d", game->lines);
+    if (full || game->combo != shadow.game.combo) {
+        tdraw_field(winginfo, 6, 3, "combo: %d", game->combo);
+    }
+    if (full || game->lines != shadow.game.lines) {
+        tdraw_field(winginfo, 7, 3, "lines: %d", game->lines);
+    }
 
-    mvwprintw(winginfo, 8, 1, "tetris_game: tetromino queue");
-    mvwprintw(winginfo, 9, 3, "queue idx: %d", game->qidx);
-    mvwprintw(winginfo, 10, 3, "pqueue: ");
-    for (int i = 0; i < 7; i++)
+    if (full || frame->bag_idx != shadow.bag_idx) {
+        tdraw_field(winginfo, 9, 3, "bag idx: %d", frame->bag_idx);
+    }
+    if (full || memcmp(frame->bag, shadow.bag, sizeof(frame->bag)))
     {
-        tdraw_block(winginfo, game->queue[i]);
+        wmove(winginfo, 10, 8);
+        for (int i = 0; i < TETRIS_BAG_SIZE && i < 11; i++)
+        {
+            tdraw_block(winginfo, frame->bag[i]);
+        }
+    }
+    if (full || memcmp(frame->next, shadow.next, sizeof(frame->next)))
+    {
+        wmove(winginfo, 11, 9);
+        for (int i = 0; i < 10; i++)
+        {
+            tdraw_block(winginfo, frame->next[i]);
+        }
+    }
+    if (full || frame->rng != shadow.rng) {
+        tdraw_field(winginfo, 12, 3, "rng: %08x", frame->rng);
+    }
+
+    if (full || game->tmicro != shadow.game.tmicro) {
+        tdraw_field(winginfo, 14, 3, "tmicro: %ld", (long)game->tmicro);
     }
-    mvwprintw(winginfo, 11, 3, "squeue: ");
-    for (int i = 0; i < 7; i++)
+    if (full || frame->gacc != shadow.gacc) {
+        tdraw_field(winginfo, 15, 3, "gacc: %08x", frame->gacc);
+    }
+    if (full || frame->jitter != shadow.jitter || frame->jitter_max != shadow.jitter_max) {
+        tdraw_field(winginfo, 16, 3, "jitter: %uus max %uus", frame->jitter, frame->jitter_max);
+    }
+
+    if (full || game->fcol != shadow.game.fcol)
     {
-        tdraw_block(winginfo, game->shuffle_queue[i]);
+        wmove(winginfo, 18, 18);
+        tdraw_block(winginfo, game->fcol);
+    }
+    if (full || frame->frot != shadow.frot) {
+        tdraw_field(winginfo, 19, 3, "falling rotation: %d", frame->frot);
+    }
+    if (full || frame->gc_valid != shadow.gc_valid) {
+        tdraw_field(winginfo, 20, 3, "gc_valid: %s", frame->gc_valid ? "true" : "false");
     }
-    mvwprintw(winginfo, 12, 3, "randx: %d", game->randx);
 
-    mvwprintw(winginfo, 13, 1, "tetris_game: time");
-    mvwprintw(winginfo, 14, 3, "tmicro: %ld", game->tmicro);
-    mvwprintw(winginfo, 15, 3, "tdrop: %ld", game->tdrop);
+    // Remember what was drawn. tmicro changes every tick, so the window is always queued for the next update.
+    shadow.game.flags = game->flags;
+    shadow.game.combo = game->combo;
+    shadow.game.lines = game->lines;
+    shadow.game.tmicro = game->tmicro;
+    shadow.game.fcol = game->fcol;
+    shadow.bag_idx = frame->bag_idx;
+    memcpy(shadow.bag, frame->bag, sizeof(frame->bag));
+    memcpy(shadow.next, frame->next, sizeof(frame->next));
+    shadow.rng = frame->rng;
+    shadow.gacc = frame->gacc;
+    shadow.jitter = frame->jitter;
+    shadow.jitter_max = frame->jitter_max;
+    shadow.frot = frame->frot;
+    shadow.gc_valid = frame->gc_valid;
+    shadow_stale &= ~TDRAW_STALE_GINFO;
+
+    wnoutrefresh(winginfo);
 
-    mvwprintw(winginfo, 17, 1, "tetris_board:");
-    mvwprintw(winginfo, 18, 3, "falling color: ");
-    tdraw_block(winginfo, game->board->fcol);
-    mvwprintw(winginfo, 19, 3, "falling rotation: %d", game->board->frot);
-    mvwprintw(winginfo, 20, 3, "gc_valid: %s", game->board->gc_valid ? "true" : "false");
+    return SUCCESS;
+}
 
-    wrefresh(winginfo);
+int tdraw_frame(const tdraw_frame_t* frame)
+{
+    // Input arg check
+    if (!frame) {
+        return ERROR_NULL_INARG;
+    }
+
+    // Every window queues its changes, the terminal gets them in one update
+    tdraw_pfield(frame);
+    tdraw_pprev(frame);
+    tdraw_score(frame);
+    tdraw_ginfo(frame);
+    doupdate();
 
     return SUCCESS;
 }
@@ -1210,6 +1425,7 @@ int tdraw_wininit()
 {
     // Calculate offsets
     win_offsets = tdraw_calc_offsets();
+    shadow_stale = TDRAW_STALE_ALL;
 
 
     // --- Allocate windows and apply offsets --- //
@@ -1270,6 +1486,9 @@ int tdraw_winupdate()
     // Calculate window offsets. 
     new_winoff = tdraw_calc_offsets();
 
+    // Windows are moved or recreated, so the shadow frame no longer matches them
+    shadow_stale = TDRAW_STALE_ALL;
+
 
     //  --- Apply window offsets. Allocate and delete windows as needed --- //
 
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <ncurses.h>
 #include "btetris_game.h"
+#include "btetris_publish.h"
 
 #ifndef __DTETRIS__
 #define __DTETRIS__
@@ -13,9 +14,25 @@ typedef enum tdraw_error {
     ERROR_NULL_GVAR = 2,
     ERROR_NCURSES_NOCOLOR = 16,
     ERROR_NCURSES_WINDOW = 17,
-    ERROR_NCURSES_PRINT = 18
+    ERROR_NCURSES_PRINT = 18,
+    ERROR_THREAD = 32,
+    ERROR_TERMINAL = 33
 } tdraw_error_t;
 
+// Snapshot of a game taken by the simulation, everything the game windows draw. Lets them be drawn without the game.
+typedef struct tdraw_frame {
+    tetris_frame_t  game;           // Playfield, tetrominoes and score, see btetris_publish.h
+    int8_t          frot;           // Falling tetromino rotation
+    int8_t          gc_valid;       // Ghost piece cache was valid before the snapshot
+    int8_t          bag_idx;
+    int8_t          bag[TETRIS_BAG_SIZE];
+    int8_t          next[10];       // Next tetrominoes out of the bag
+    uint32_t        rng;            // First word of the rng state
+    uint32_t        gacc;
+    uint32_t        jitter;         // Mean tick jitter in microseconds, filled in by the simulation loop
+    uint32_t        jitter_max;     // Largest tick jitter in microseconds
+} tdraw_frame_t;
+
 
 /// @brief Draws the start menu. Starts game before returning. 
 /// @param game Game object
@@ -36,25 +53,36 @@ int tdraw_gameover(tetris_game_t* game);
 /// @return Error value
 int tdraw_title();
 
-/// @brief Draws tetris playfield. 
+/// @brief Takes a snapshot of a game to be drawn later, leaves the jitter fields as they are
+/// @param frame Snapshot to fill
 /// @param game Game object
 /// @return Error value
-int tdraw_pfield(tetris_game_t* game);
+int tdraw_snapshot(tdraw_frame_t* frame, tetris_game_t* game);
 
-/// @brief Draws tetris piece preview 
-/// @param game Game object
+/// @brief Draws the playfield cells that changed since the last frame. Queues the window, call doupdate() after.
+/// @param frame Game snapshot
 /// @return Error value
-int tdraw_pprev(tetris_game_t* game);
+int tdraw_pfield(const tdraw_frame_t* frame);
 
-/// @brief Draws score info
-/// @param game Game object
+/// @brief Draws the piece preview slots that changed since the last frame. Queues the window, call doupdate() after.
+/// @param frame Game snapshot
 /// @return Error value
-int tdraw_score(tetris_game_t* game);
+int tdraw_pprev(const tdraw_frame_t* frame);
 
-/// @brief Draws debug info
-/// @param game Game object
+/// @brief Draws score info that changed since the last frame. Queues the window, call doupdate() after.
+/// @param frame Game snapshot
+/// @return Error value
+int tdraw_score(const tdraw_frame_t* frame);
+
+/// @brief Draws debug info that changed since the last frame. Queues the window, call doupdate() after.
+/// @param frame Game snapshot
+/// @return Error value
+int tdraw_ginfo(const tdraw_frame_t* frame);
+
+/// @brief Draws everything in a frame that changed since the last one and updates the terminal once
+/// @param frame Game snapshot
 /// @return Error value
-int tdraw_ginfo(tetris_game_t* game);
+int tdraw_frame(const tdraw_frame_t* frame);
 
 /// @brief Inits ncurses color. Sets up color values.  
 /// @return Error value
@@ -0,0 +1,164 @@
+#include "trender.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+
+// --- Private Functions --- //
+
+/// @brief Render thread, draws frames as they are submitted, at most TRENDER_HZ times a second, until stopped
+/// @param arg Render object
+/// @return NULL
+void* trender_loop(void* arg);
+
+/// @brief Wakes the render thread
+/// @param render Render object
+void trender_wake(trender_t* render);
+
+
+int trender_init(trender_t* render, int (*draw)(const tdraw_frame_t* frame))
+{
+    if (!render || !draw) {
+        return ERROR_NULL_INARG;
+    }
+
+    memset(render->slots, 0, sizeof(render->slots));
+    for (int i = 0; i < 3; i++) {
+        render->slots[i].game.pf_height = -1;
+    }
+    atomic_init(&render->ready, 0);
+    render->back = 1;
+    render->front = 2;
+    render->draw = draw;
+    pthread_mutex_init(&render->lock, NULL);
+    atomic_init(&render->running, 0);
+    render->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (render->wake < 0) {
+        return ERROR_THREAD;
+    }
+    render->submitted = 0;
+    atomic_init(&render->drawn, 0);
+
+    return SUCCESS;
+}
+
+tdraw_frame_t* trender_back(trender_t* render)
+{
+    return &render->slots[render->back];
+}
+
+void trender_submit(trender_t* render)
+{
+    // Release makes the filled slot visible to the renderer, acquire gets back a slot it is done with
+    render->back = atomic_exchange_explicit(&render->ready, render->back | TRENDER_FRESH, memory_order_acq_rel) & 3;
+    render->submitted++;
+
+    // Wake the render thread, it sleeps until there is something to draw
+    if (atomic_load_explicit(&render->running, memory_order_relaxed)) {
+        trender_wake(render);
+    }
+}
+
+int trender_draw(trender_t* render)
+{
+    tdraw_frame_t* frame;
+
+    // Stale frame, nothing to draw
+    if (!(atomic_load_explicit(&render->ready, memory_order_relaxed) & TRENDER_FRESH)) {
+        return 0;
+    }
+    render->front = atomic_exchange_explicit(&render->ready, render->front, memory_order_acq_rel) & 3;
+    frame = &render->slots[render->front];
+
+    pthread_mutex_lock(&render->lock);
+    render->draw(frame);
+    pthread_mutex_unlock(&render->lock);
+
+    atomic_fetch_add_explicit(&render->drawn, 1, memory_order_relaxed);
+
+    return 1;
+}
+
+int trender_start(trender_t* render)
+{
+    if (!render) {
+        return ERROR_NULL_INARG;
+    }
+
+    atomic_store(&render->running, 1);
+    if (pthread_create(&render->thread, NULL, trender_loop, render))
+    {
+        atomic_store(&render->running, 0);
+        return ERROR_THREAD;
+    }
+
+    return SUCCESS;
+}
+
+void trender_stop(trender_t* render)
+{
+    if (atomic_exchange(&render->running, 0))
+    {
+        trender_wake(render);
+        pthread_join(render->thread, NULL);
+    }
+}
+
+
+// --- Private Function Definitions --- //
+
+void* trender_loop(void* arg)
+{
+    trender_t* render = arg;
+    struct pollfd pfd = {.fd = render->wake, .events = POLLIN};
+    struct timespec next, now;
+    sigset_t mask;
+    uint64_t count;
+
+    // Signals are left to the simulation thread, ncurses relies on SIGWINCH interrupting its wait
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (atomic_load(&render->running))
+    {
+        // Sleep until a frame is submitted, then reset the eventfd. The count doesn't matter, only the newest frame is drawn.
+        // EAGAIN means another wakeup already reset it.
+        if (poll(&pfd, 1, -1) > 0)
+        {
+            while (read(render->wake, &count, sizeof(count)) < 0 && errno == EINTR) {
+                ;
+            }
+        }
+        trender_draw(render);
+
+        // Sleep out the rest of the frame period so drawing is capped at TRENDER_HZ. A slow terminal skips deadlines instead of bursting.
+        next.tv_nsec += 1000000000 / TRENDER_HZ;
+        if (next.tv_nsec >= 1000000000)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+void trender_wake(trender_t* render)
+{
+    uint64_t one = 1;
+
+    // EAGAIN means the counter is saturated, the thread is awake either way
+    while (write(render->wake, &one, sizeof(one)) < 0 && errno == EINTR) {
+        ;
+    }
+}
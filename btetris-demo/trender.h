@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "tdraw.h"
+
+#ifndef __TRENDER__
+#define __TRENDER__
+
+// Most frames the render thread draws per second
+#ifndef TRENDER_HZ
+    #define TRENDER_HZ 60
+#elif TRENDER_HZ < 1
+    #error invalid render rate, too small
+#elif TRENDER_HZ > 1000
+    #error invalid render rate, too large
+#endif
+
+// Set in `ready` until the renderer takes the newest frame
+#define TRENDER_FRESH 4
+
+/*
+ * Triple buffer between the simulation and the renderer. The simulation fills the back slot and swaps it with the
+ * ready slot, the renderer swaps the ready slot with its front slot only when a fresh frame is there. Neither side
+ * waits for the other, frames the renderer did not get to are overwritten and never drawn.
+ */
+typedef struct trender {
+    tdraw_frame_t   slots[3];
+    atomic_uint     ready;      // Slot holding the newest frame, TRENDER_FRESH set if it wasn't drawn yet
+    int             back;       // Slot being filled, only used by the simulation
+    int             front;      // Slot being drawn, only used by the renderer
+    int (*draw)(const tdraw_frame_t* frame);    // Backend that draws a frame, tdraw_frame or tvt_frame
+    pthread_mutex_t lock;       // Held around every ncurses call once the render thread runs, and around draw
+    pthread_t       thread;
+    int             wake;       // eventfd the render thread sleeps on until a frame is submitted
+    atomic_int      running;
+    uint64_t        submitted;  // Frames handed over by the simulation
+    atomic_ulong    drawn;      // Frames drawn by the renderer
+} trender_t;
+
+
+/// @brief Initializes the triple buffer. Does not start the render thread.
+/// @param render Render object
+/// @param draw Backend that draws a frame
+/// @return Error value
+int trender_init(trender_t* render, int (*draw)(const tdraw_frame_t* frame));
+
+/// @brief Gets the slot the simulation fills next
+/// @param render Render object
+/// @return Back slot
+tdraw_frame_t* trender_back(trender_t* render);
+
+/// @brief Hands the back slot to the renderer. Never blocks.
+/// @param render Render object
+void trender_submit(trender_t* render);
+
+/// @brief Draws the newest frame if it wasn't drawn yet. Called by the render thread, or by the simulation without one.
+/// @param render Render object
+/// @return 1 if a frame was drawn, 0 otherwise
+int trender_draw(trender_t* render);
+
+/// @brief Starts the render thread, which draws frames as they are submitted, at most TRENDER_HZ times a second
+/// @param render Render object
+/// @return Error value
+int trender_start(trender_t* render);
+
+/// @brief Stops the render thread if it runs
+/// @param render Render object
+void trender_stop(trender_t* render);
+
+#endif
@@ -0,0 +1,446 @@
+#include "tvt.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// --- DEFINITIONS --- //
+
+// Window positions, same as the tdraw layout without the title
+#define TVT_PFIELD_X 1
+#define TVT_PFIELD_Y 1
+#define TVT_PFIELD_WWIDTH (TETRIS_WIDTH*2 + 2)
+#define TVT_PFIELD_WHEIGHT (TETRIS_HEIGHT + 2)
+
+#define TVT_PPREVIEW_X (TVT_PFIELD_X + TVT_PFIELD_WWIDTH + 1)
+#define TVT_PPREVIEW_Y 1
+#define TVT_PPREVIEW_WWIDTH (1 + 9 * TETRIS_PP_SIZE)
+#define TVT_PPREVIEW_WHEIGHT 6
+
+#define TVT_SCORE_X TVT_PPREVIEW_X
+#define TVT_SCORE_Y (TVT_PPREVIEW_Y + TVT_PPREVIEW_WHEIGHT)
+#define TVT_SCORE_WHEIGHT 4
+
+// Playfield cell above pf_height, left in the terminal's default background
+#define TVT_ERASED 0xFF
+
+// Background color of the terminal, see tvt_bg
+#define TVT_BG_DEFAULT -1
+
+
+// --- GLOBAL VARS --- //
+
+// 24-bit block colors by tetris_color_t, the same colors tdraw asks ncurses for
+const uint8_t TVT_COLORS[10][3] = {
+    {0, 0, 0},          // TETRIS_BLANK
+    {0, 229, 229},      // TETRIS_CYAN
+    {229, 229, 0},      // TETRIS_YELLOW
+    {25, 25, 229},      // TETRIS_BLUE
+    {229, 127, 0},      // TETRIS_ORANGE
+    {0, 229, 0},        // TETRIS_GREEN
+    {127, 0, 229},      // TETRIS_PURPLE
+    {229, 0, 0},        // TETRIS_RED
+    {64, 64, 64},       // TETRIS_WALL
+    {128, 128, 128}     // TETRIS_GARBAGE
+};
+
+// Output is gathered here and written once per frame
+char tvt_buf[TVT_BUFSIZE];
+int tvt_len;
+
+// Terminal state as left by the last output, so redundant moves and color changes are skipped
+int tvt_x, tvt_y;
+int tvt_bg;
+
+// Last frame drawn, only what differs from it is drawn again
+uint8_t tvt_shadow_pf[TETRIS_HEIGHT][TETRIS_WIDTH];
+int8_t tvt_shadow_pp[TETRIS_PP_SIZE];
+int64_t tvt_shadow_score;
+int8_t tvt_shadow_level;
+
+// Input read ahead of tvt_getch
+unsigned char tvt_in[64];
+int tvt_inlen, tvt_inpos;
+
+// Terminal settings to restore, set while tvt_init is in effect
+struct termios tvt_termios;
+int tvt_active;
+
+
+// --- Private Functions --- //
+
+/// @brief Appends bytes to the output buffer, writing the buffer out first if they don't fit
+/// @param data Bytes to append
+/// @param len Number of bytes
+void tvt_put(const char* data, int len);
+
+/// @brief Appends formatted text to the output buffer
+/// @param fmt printf format
+void tvt_printf(const char* fmt, ...);
+
+/// @brief Moves the cursor, nothing is written if it is already there
+/// @param y Screen row, 0 is the top
+/// @param x Screen column, 0 is the left
+void tvt_move(int y, int x);
+
+/// @brief Sets the background color, nothing is written if it is already set
+/// @param color tetris_color_t, or TVT_BG_DEFAULT for the terminal's own background
+void tvt_bg_set(int color);
+
+/// @brief Writes text at the cursor, which advances with it. Text must not contain control characters.
+/// @param text Text to write
+void tvt_text(const char* text);
+
+/// @brief Draws a block two columns wide at the cursor
+/// @param color tetris_color_t, or TVT_ERASED for the default background
+void tvt_block(int color);
+
+/// @brief Draws a box with DEC line drawing characters
+/// @param y Top row
+/// @param x Left column
+/// @param height Box height
+/// @param width Box width
+void tvt_box(int y, int x, int height, int width);
+
+/// @brief Writes the output buffer to the terminal
+/// @return Error value
+int tvt_flush();
+
+/// @brief Moves unread input to the front of the input buffer and reads more after it without blocking
+/// @return Number of bytes read, 0 or less if none
+ssize_t tvt_fill();
+
+
+int tvt_init()
+{
+    struct termios raw;
+
+    // Raw input that never blocks, Ctrl-C is read as a key so the terminal can be restored on exit
+    if (tcgetattr(STDIN_FILENO, &tvt_termios) < 0) {
+        return ERROR_TERMINAL;
+    }
+    raw = tvt_termios;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0) {
+        return ERROR_TERMINAL;
+    }
+    tvt_active = 1;
+
+    // Alternate screen, hidden cursor, cleared with the default background
+    tvt_len = 0;
+    tvt_text("\033[?1049h\033[?25l\033[0m\033[2J\033[H");
+    tvt_x = tvt_y = 0;
+    tvt_bg = TVT_BG_DEFAULT;
+
+    // Window borders and labels are drawn once
+    tvt_box(TVT_PFIELD_Y, TVT_PFIELD_X, TVT_PFIELD_WHEIGHT, TVT_PFIELD_WWIDTH);
+    tvt_box(TVT_PPREVIEW_Y, TVT_PPREVIEW_X, TVT_PPREVIEW_WHEIGHT, TVT_PPREVIEW_WWIDTH);
+    tvt_box(TVT_SCORE_Y, TVT_SCORE_X, TVT_SCORE_WHEIGHT, TVT_PPREVIEW_WWIDTH);
+    for (int i = 1; i < 5; i++)
+    {
+        tvt_move(TVT_PPREVIEW_Y + i, TVT_PPREVIEW_X + 9);
+        tvt_text("|");
+    }
+
+    // Screen is now blank, the first frame draws everything
+    memset(tvt_shadow_pf, TVT_ERASED, sizeof(tvt_shadow_pf));
+    memset(tvt_shadow_pp, -1, sizeof(tvt_shadow_pp));
+    tvt_shadow_score = -1;
+    tvt_shadow_level = -1;
+
+    return tvt_flush();
+}
+
+void tvt_end()
+{
+    if (!tvt_active) {
+        return;
+    }
+    tvt_active = 0;
+
+    tvt_len = 0;
+    tvt_text("\033[0m\033[?25h\033[?1049l");
+    tvt_flush();
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &tvt_termios);
+}
+
+int tvt_frame(const tdraw_frame_t* frame)
+{
+    const tetris_frame_t* game;
+    uint8_t view[TETRIS_HEIGHT][TETRIS_WIDTH];  // Playfield as it is shown
+    char text[TVT_PPREVIEW_WWIDTH];
+    int8_t pcolor;
+
+    // Input arg check
+    if (!frame) {
+        return ERROR_NULL_INARG;
+    }
+    if (!tvt_active) {
+        return ERROR_NULL_GVAR;
+    }
+    game = &frame->game;
+
+    // Compose the playfield, rows above pf_height are left erased
+    memset(view, TVT_ERASED, sizeof(view));
+    for (int y = 0; y <= game->pf_height && y < TETRIS_HEIGHT; y++)
+    {
+        memcpy(view[y], game->pf[y], TETRIS_WIDTH);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        if (0 > game->fpos[i].h || game->fpos[i].h >= TETRIS_HEIGHT ||
+            0 > game->fpos[i].w || game->fpos[i].w >= TETRIS_WIDTH) {
+            continue;
+        }
+        view[game->fpos[i].h][game->fpos[i].w] = game->fcol;
+    }
+
+    // Draw playfield cells that changed, top row first so runs on a row need no cursor moves
+    for (int y = TETRIS_HEIGHT - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < TETRIS_WIDTH; x++)
+        {
+            if (view[y][x] == tvt_shadow_pf[y][x]) {
+                continue;
+            }
+            tvt_move(TVT_PFIELD_Y + TETRIS_HEIGHT - y, TVT_PFIELD_X + 1 + x*2);
+            tvt_block(view[y][x]);
+        }
+    }
+    memcpy(tvt_shadow_pf, view, sizeof(view));
+
+    // Draw piece preview slots that changed
+    for (int ppi = 0; ppi < TETRIS_PP_SIZE; ppi++)
+    {
+        pcolor = game->ppreview[ppi];
+        if (pcolor == tvt_shadow_pp[ppi]) {
+            continue;
+        }
+        tvt_shadow_pp[ppi] = pcolor;
+
+        // Clear slot
+        for (int i = 1; i < 5; i++)
+        {
+            tvt_move(TVT_PPREVIEW_Y + i, TVT_PPREVIEW_X + 1 + ppi * 9);
+            for (int j = 0; j < 4; j++) {
+                tvt_block(TVT_ERASED);
+            }
+        }
+        if (pcolor <= TETRIS_BLANK || pcolor > TETRIS_RED) {
+            continue;
+        }
+
+        // Same placement as tdraw_pprev
+        for (int ppj = 0; ppj < 4; ppj++)
+        {
+            tetris_coord_t coord = TETRIS_TETROMINO_START[(int)pcolor][ppj];
+            int h = 3 - (coord.h - TETRIS_HEIGHT);
+            int w = coord.w - (TETRIS_WIDTH/2 - 2);
+
+            tvt_move(TVT_PPREVIEW_Y + h + 1, TVT_PPREVIEW_X + w*2 + ppi * 9 + (pcolor > 2) + 1);
+            tvt_block(pcolor);
+        }
+    }
+
+    // Draw score and level if they changed, padded up to the border
+    if (game->score != tvt_shadow_score)
+    {
+        tvt_shadow_score = game->score;
+        snprintf(text, sizeof(text), "Score: %-*ld", TVT_PPREVIEW_WWIDTH - 9, (long)game->score);
+        tvt_bg_set(TVT_BG_DEFAULT);
+        tvt_move(TVT_SCORE_Y + 1, TVT_SCORE_X + 1);
+        tvt_text(text);
+    }
+    if (game->level != tvt_shadow_level)
+    {
+        tvt_shadow_level = game->level;
+        snprintf(text, sizeof(text), "Level: %-*d", TVT_PPREVIEW_WWIDTH - 9, game->level);
+        tvt_bg_set(TVT_BG_DEFAULT);
+        tvt_move(TVT_SCORE_Y + 2, TVT_SCORE_X + 1);
+        tvt_text(text);
+    }
+
+    return tvt_flush();
+}
+
+int tvt_getch()
+{
+    int key;
+
+    // Read everything pending at once, keys are handed out one per call
+    if (tvt_inpos >= tvt_inlen && tvt_fill() <= 0) {
+        return ERR;
+    }
+
+    // A sequence cut off after ESC or ESC [ gets one more read. A lone ESC is taken as the Escape key,
+    // an ESC [ waits for the rest of its sequence so an arrow split across reads isn't taken for Escape.
+    if (tvt_in[tvt_inpos] == 27 && (tvt_inlen - tvt_inpos == 1 || (tvt_inlen - tvt_inpos == 2 && tvt_in[tvt_inpos + 1] == '[')))
+    {
+        tvt_fill();
+        if (tvt_inlen - tvt_inpos == 2 && tvt_in[tvt_inpos + 1] == '[') {
+            return ERR;
+        }
+    }
+
+    // Arrow keys arrive as ESC [ A..D, a lone ESC is returned as is
+    key = tvt_in[tvt_inpos++];
+    if (key == 27 && tvt_inpos + 1 < tvt_inlen && tvt_in[tvt_inpos] == '[')
+    {
+        switch (tvt_in[tvt_inpos + 1])
+        {
+            case 'A': key = KEY_UP; break;
+            case 'B': key = KEY_DOWN; break;
+            case 'C': key = KEY_RIGHT; break;
+            case 'D': key = KEY_LEFT; break;
+            default: return key;
+        }
+        tvt_inpos += 2;
+    }
+
+    return key;
+}
+
+
+// --- Private Function Definitions --- //
+
+void tvt_put(const char* data, int len)
+{
+    if (tvt_len + len > TVT_BUFSIZE) {
+        tvt_flush();
+    }
+    memcpy(tvt_buf + tvt_len, data, len);
+    tvt_len += len;
+}
+
+void tvt_printf(const char* fmt, ...)
+{
+    char text[64];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    tvt_put(text, (len < (int)sizeof(text)) ? len : (int)sizeof(text) - 1);
+}
+
+void tvt_move(int y, int x)
+{
+    if (y == tvt_y && x == tvt_x) {
+        return;
+    }
+
+    // Same row only needs a column, which is shorter
+    if (y == tvt_y) {
+        tvt_printf("\033[%dG", x + 1);
+    }
+    else {
+        tvt_printf("\033[%d;%dH", y + 1, x + 1);
+    }
+    tvt_y = y;
+    tvt_x = x;
+}
+
+void tvt_bg_set(int color)
+{
+    if (color == tvt_bg) {
+        return;
+    }
+
+    if (color == TVT_BG_DEFAULT) {
+        tvt_put("\033[49m", 5);
+    }
+    else {
+        tvt_printf("\033[48;2;%d;%d;%dm", TVT_COLORS[color][0], TVT_COLORS[color][1], TVT_COLORS[color][2]);
+    }
+    tvt_bg = color;
+}
+
+void tvt_text(const char* text)
+{
+    int len = strlen(text);
+
+    tvt_put(text, len);
+    tvt_x += len;
+}
+
+void tvt_block(int color)
+{
+    tvt_bg_set((color == TVT_ERASED || color < 0 || color > TETRIS_GARBAGE) ? TVT_BG_DEFAULT : color);
+    tvt_put("  ", 2);
+    tvt_x += 2;
+}
+
+void tvt_box(int y, int x, int height, int width)
+{
+    // Line drawing set is switched in and out around each row
+    tvt_bg_set(TVT_BG_DEFAULT);
+    for (int i = 0; i < height; i++)
+    {
+        tvt_move(y + i, x);
+        tvt_put("\033(0", 3);
+        if (i == 0 || i == height - 1)
+        {
+            tvt_put((i == 0) ? "l" : "m", 1);
+            for (int j = 0; j < width - 2; j++) {
+                tvt_put("q", 1);
+            }
+            tvt_put((i == 0) ? "k" : "j", 1);
+            tvt_x += width;
+        }
+        else
+        {
+            tvt_put("x", 1);
+            tvt_printf("\033[%dG", x + width);
+            tvt_put("x", 1);
+            tvt_x = x + width;
+        }
+        tvt_put("\033(B", 3);
+    }
+}
+
+int tvt_flush()
+{
+    ssize_t n;
+    int off = 0;
+
+    // A single write, repeated only if the terminal took part of it
+    while (off < tvt_len)
+    {
+        n = write(STDOUT_FILENO, tvt_buf + off, tvt_len - off);
+        if (n < 0)
+        {
+            if (errno == EINTR) {
+                continue;
+            }
+            tvt_len = 0;
+            return ERROR_NCURSES_PRINT;
+        }
+        off += n;
+    }
+    tvt_len = 0;
+
+    return SUCCESS;
+}
+
+ssize_t tvt_fill()
+{
+    ssize_t n;
+
+    memmove(tvt_in, tvt_in + tvt_inpos, tvt_inlen - tvt_inpos);
+    tvt_inlen -= tvt_inpos;
+    tvt_inpos = 0;
+
+    n = read(STDIN_FILENO, tvt_in + tvt_inlen, sizeof(tvt_in) - tvt_inlen);
+    if (n > 0) {
+        tvt_inlen += (int)n;
+    }
+
+    return n;
+}
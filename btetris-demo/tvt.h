@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include "tdraw.h"
+
+#ifndef __TVT__
+#define __TVT__
+
+// Size of the output buffer. A full redraw of the default 10x20 playfield takes about 7kB.
+#ifndef TVT_BUFSIZE
+    #define TVT_BUFSIZE 16384
+#elif TVT_BUFSIZE < 256
+    #error invalid output buffer size, too small
+#endif
+
+
+/// @brief Takes over the terminal: raw non-blocking input, alternate screen and hidden cursor.
+/// Draws the window borders, the terminal is restored by tvt_end().
+/// @return Error value
+int tvt_init();
+
+/// @brief Restores the terminal to how tvt_init() found it. Safe to call more than once, and from atexit.
+void tvt_end();
+
+/// @brief Draws everything in a frame that changed since the last one, with one write() to the terminal.
+/// Same playfield, piece preview and score layout as tdraw, blocks are drawn in 24-bit color.
+/// @param frame Game snapshot
+/// @return Error value
+int tvt_frame(const tdraw_frame_t* frame);
+
+/// @brief Reads a key without blocking. Arrow key sequences are returned as ncurses KEY_ codes.
+/// An `ESC [` split from the rest of its sequence is kept until a later read completes it.
+/// @return Key, ERR if none is pending
+int tvt_getch();
+
+#endif
@@ -0,0 +1,221 @@
+#include "hbench.h"
+#include "btetris_control.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Games ticked round robin by the gravity benchmark
+#define HBENCH_GAMES 256
+
+// Moves made by the wall benchmark between clock reads
+#define HBENCH_BATCH 1024
+
+// Tetromino pinned against a wall
+typedef struct hbench_pin {
+    tetris_coord_t  fpos[4];
+    tetris_color_t  fcol;
+    int8_t          frot;
+    int8_t          wall;   // -1 for the left wall, 1 for the right wall
+} hbench_pin_t;
+
+
+// --- Private Functions --- //
+
+/// @brief Counts locked tetrominoes
+/// @param game Game object
+/// @param state Lock counter
+/// @return Error code
+tetris_error_t hbench_lock(tetris_game_t* game, void* state);
+
+/// @brief Puts a pinned tetromino back against its wall
+/// @param board Board object
+/// @param pin Pinned tetromino
+void hbench_place(tetris_board_t* board, const hbench_pin_t* pin);
+
+/// @brief Gets monotonic time in microseconds
+/// @return Time
+uint64_t hbench_now();
+
+
+// --- Public Functions --- //
+
+int hbench_gravity_main(int argc, char** argv)
+{
+    static const uint32_t curve_20g[1] = {TETRIS_GRAVITY_20G};
+
+    int level = (argc > 1) ? atoi(argv[1]) : TETRIS_GRAVITY_LEVELS - 1;
+    uint64_t tmicro = (argc > 2) ? strtoull(argv[2], NULL, 10) : 100000;
+    int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+
+    tetris_game_t* games;
+    tetris_board_t* boards;
+    uint64_t ticks = 0, locks = 0, resets = 0;
+    uint64_t tstart, tend;
+
+    if (level > 127)
+    {
+        fprintf(stderr, "level must be at most 127\n");
+        return 1;
+    }
+
+    games = calloc(HBENCH_GAMES, sizeof(tetris_game_t));
+    boards = calloc(HBENCH_GAMES, sizeof(tetris_board_t));
+    if (!games || !boards)
+    {
+        fprintf(stderr, "out of memory\n");
+        free(games);
+        free(boards);
+        return 1;
+    }
+
+    for (int i = 0; i < HBENCH_GAMES; i++)
+    {
+        tetris_init(&games[i], &boards[i], i + 1);
+        if (level < 0) {
+            tetris_set_gravity(&games[i], curve_20g, 1);
+        }
+        else {
+            tetris_set_level(&games[i], level);
+        }
+        tetris_set_lockfunc(&games[i], hbench_lock, &locks);
+        tetris_start(&games[i]);
+    }
+
+    // Clock is only read once per round so it doesn't show up in the tick cost
+    tstart = hbench_now();
+    tend = tstart + (uint64_t)seconds * 1000000;
+    while (hbench_now() < tend)
+    {
+        for (int i = 0; i < HBENCH_GAMES; i++)
+        {
+            if (tetris_tick(&games[i], tmicro) == TETRIS_ERROR_GAME_OVER)
+            {
+                tetris_reset(&games[i]);
+                tetris_start(&games[i]);
+                resets++;
+            }
+        }
+        ticks += HBENCH_GAMES;
+    }
+    tend = hbench_now();
+
+    printf("level %d (%s), %" PRIu64 " us ticks, %" PRIu64 " ticks in %.2f s\n", level, (level < 0) ? "20G" : "curve", tmicro, ticks, (tend - tstart) / 1e6);
+    printf("ticks/s %.0f, locks/s %.0f, games/s %.0f\n", ticks * 1e6 / (tend - tstart), locks * 1e6 / (tend - tstart), resets * 1e6 / (tend - tstart));
+
+    free(games);
+    free(boards);
+
+    return 0;
+}
+
+int hbench_wall_main(int argc, char** argv)
+{
+    int seconds = (argc > 1) ? atoi(argv[1]) : 4;
+
+    tetris_game_t game;
+    tetris_board_t board;
+    hbench_pin_t pins[4*TETRIS_RED];
+    int npins = 0;
+    uint64_t shifts = 0, rotations = 0, kicks = 0;
+    uint64_t tstart, tshift, trot;
+
+    tetris_init(&game, &board, 1);
+    tetris_start(&game);
+
+    // Shift every tetromino, flat and rotated once, from its spawn position until it hits each wall
+    for (tetris_color_t col = TETRIS_CYAN; col <= TETRIS_RED; col++)
+    {
+        for (int8_t rot = 0; rot < 2; rot++)
+        {
+            for (int8_t wall = -1; wall <= 1; wall += 2)
+            {
+                pins[npins].fcol = col;
+                pins[npins].frot = 0;
+                pins[npins].wall = wall;
+                for (int i = 0; i < 4; i++) {
+                    pins[npins].fpos[i] = TETRIS_TETROMINO_START[col][i];
+                }
+                hbench_place(&board, &pins[npins]);
+                if (rot) {
+                    tetris_rotcw(&game);
+                }
+                while (((wall < 0) ? tetris_leftshift(&game) : tetris_rightshift(&game)) == TETRIS_SUCCESS);
+                for (int i = 0; i < 4; i++) {
+                    pins[npins].fpos[i] = board.fpos[i];
+                }
+                pins[npins].frot = board.frot;
+                npins++;
+            }
+        }
+    }
+
+    // Shifts into the wall, every one of them is blocked
+    tstart = hbench_now();
+    do
+    {
+        for (int n = 0; n < HBENCH_BATCH; n++)
+        {
+            const hbench_pin_t* pin = &pins[n % npins];
+            hbench_place(&board, pin);
+            if (((pin->wall < 0) ? tetris_leftshift(&game) : tetris_rightshift(&game)) != TETRIS_ERROR_COLLISION)
+            {
+                fprintf(stderr, "tetromino %d shifted through the wall\n", pin->fcol);
+                return 1;
+            }
+        }
+        shifts += HBENCH_BATCH;
+        tshift = hbench_now() - tstart;
+    } while (tshift < (uint64_t)seconds * 500000);
+
+    // Rotations against the wall, alternating directions, most of them need a kick
+    tstart = hbench_now();
+    do
+    {
+        for (int n = 0; n < HBENCH_BATCH; n++)
+        {
+            const hbench_pin_t* pin = &pins[n % npins];
+            hbench_place(&board, pin);
+            if (((n / npins) & 1) ? tetris_rotcntrcw(&game) : tetris_rotcw(&game)) {
+                continue;
+            }
+            kicks += (board.fkick > 0);
+        }
+        rotations += HBENCH_BATCH;
+        trot = hbench_now() - tstart;
+    } while (trot < (uint64_t)seconds * 500000);
+
+    printf("%d pinned tetrominoes, %" PRIu64 " shifts, %" PRIu64 " rotations (%.1f%% kicked)\n", npins, shifts, rotations, 100.0 * kicks / rotations);
+    printf("ns/shift %.1f, ns/rotation %.1f\n", tshift * 1e3 / shifts, trot * 1e3 / rotations);
+
+    return 0;
+}
+
+
+// --- Private Function Definitions --- //
+
+tetris_error_t hbench_lock(tetris_game_t* game, void* state)
+{
+    (*(uint64_t*)state)++;
+    return TETRIS_SUCCESS;
+}
+
+void hbench_place(tetris_board_t* board, const hbench_pin_t* pin)
+{
+    board->fpos[0] = pin->fpos[0];
+    board->fpos[1] = pin->fpos[1];
+    board->fpos[2] = pin->fpos[2];
+    board->fpos[3] = pin->fpos[3];
+    board->fcol = pin->fcol;
+    board->frot = pin->frot;
+    board->fkick = -1;
+    board->gc_valid = 0;
+}
+
+uint64_t hbench_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,20 @@
+#include <stdint.h>
+
+#ifndef __HBENCH__
+#define __HBENCH__
+
+/// @brief Ticks games at a high level with long ticks, so gravity drops several rows every tick, and prints
+/// tick and lock throughput. Games that end are reset and started again.
+/// @param argc Argument count, arguments are [level] [tick microseconds] [seconds]. A negative level uses 20G gravity.
+/// @param argv Arguments
+/// @return Exit code
+int hbench_gravity_main(int argc, char** argv);
+
+/// @brief Pins every tetromino, flat and rotated once, against each wall, then shifts it into the wall and rotates it in a loop.
+/// Prints the cost of a blocked shift and of a rotation, kicks included.
+/// @param argc Argument count, arguments are [seconds]
+/// @param argv Arguments
+/// @return Exit code
+int hbench_wall_main(int argc, char** argv);
+
+#endif
@@ -0,0 +1,239 @@
+#include "hnet.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Frames played per match before the peers are compared
+#define HNET_MATCH_FRAMES 1200
+
+
+// --- Private Functions --- //
+
+/// @brief Generates a random input, mostly empty frames with the occasional key press
+/// @param rng Random number generator
+/// @return Input
+tetris_input_t hnet_input(tetris_rng_t* rng);
+
+/// @brief Compares the simulated state of two sessions
+/// @param a Session object
+/// @param b Session object
+/// @return 1 if both sessions have the same state, 0 otherwise
+int hnet_same(const tetris_rollback_t* a, const tetris_rollback_t* b);
+
+/// @brief Gets CPU time used by the process in microseconds
+/// @return Time
+uint64_t hnet_cputime();
+
+
+// --- Public Functions --- //
+
+int hnet_link_init(hnet_link_t* link, int32_t latency, int32_t jitter, uint64_t seed)
+{
+    link->cap = 64;
+    link->len = 0;
+    link->msgs = malloc(link->cap * sizeof(hnet_msg_t));
+    link->latency = latency;
+    link->jitter = jitter;
+    tetris_rng_seed(&link->rng, seed);
+
+    return link->msgs ? 0 : -1;
+}
+
+void hnet_link_free(hnet_link_t* link)
+{
+    free(link->msgs);
+    link->msgs = NULL;
+    link->len = 0;
+    link->cap = 0;
+}
+
+int hnet_send(hnet_link_t* link, int32_t now, int8_t player, int32_t frame, tetris_input_t input)
+{
+    hnet_msg_t* msgs;
+
+    if (link->len == link->cap)
+    {
+        msgs = realloc(link->msgs, 2 * link->cap * sizeof(hnet_msg_t));
+        if (!msgs) {
+            return -1;
+        }
+        link->msgs = msgs;
+        link->cap *= 2;
+    }
+
+    link->msgs[link->len].deliver = now + link->latency + (int32_t)(tetris_rng_next(&link->rng) % (uint32_t)(link->jitter + 1));
+    link->msgs[link->len].frame = frame;
+    link->msgs[link->len].player = player;
+    link->msgs[link->len].input = input;
+    link->len++;
+
+    return 0;
+}
+
+void hnet_recv(hnet_link_t* link, int32_t now, tetris_rollback_t* session)
+{
+    int32_t kept = 0;
+
+    for (int32_t i = 0; i < link->len; i++)
+    {
+        if (link->msgs[i].deliver <= now) {
+            tetris_rollback_remote(session, link->msgs[i].player, link->msgs[i].frame, link->msgs[i].input);
+        }
+        else {
+            link->msgs[kept++] = link->msgs[i];
+        }
+    }
+    link->len = kept;
+}
+
+int hnet_main(int argc, char** argv)
+{
+    int32_t latency = (argc > 1) ? atoi(argv[1]) : 3;
+    int32_t jitter = (argc > 2) ? atoi(argv[2]) : 2;
+    int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+
+    tetris_rollback_t* peers[2];
+    hnet_link_t links[2];   // links[p] carries the inputs of peer p to the other peer
+    tetris_rng_t inrng[2];
+    tetris_input_t input[2];
+    int8_t pending[2];
+    uint64_t matches = 0, desyncs = 0, frames = 0, resims = 0, rollbacks = 0, stalls = 0;
+    uint64_t tstart, tend;
+    int32_t now;
+
+    peers[0] = malloc(sizeof(tetris_rollback_t));
+    peers[1] = malloc(sizeof(tetris_rollback_t));
+    if (!peers[0] || !peers[1] || hnet_link_init(&links[0], latency, jitter, 1) || hnet_link_init(&links[1], latency, jitter, 2))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    tetris_rng_seed(&inrng[0], 3);
+    tetris_rng_seed(&inrng[1], 4);
+
+    tstart = hnet_cputime();
+    tend = tstart + (uint64_t)seconds * 1000000;
+    while (hnet_cputime() < tend)
+    {
+        tetris_rollback_init(peers[0], 2, 0, matches);
+        tetris_rollback_init(peers[1], 2, 1, matches);
+        pending[0] = pending[1] = 0;
+        now = 0;
+
+        // Peers play until both reach the end of the match, a stalled peer retries the same input next frame
+        while (peers[0]->frame < HNET_MATCH_FRAMES || peers[1]->frame < HNET_MATCH_FRAMES)
+        {
+            for (int p = 0; p < 2; p++)
+            {
+                hnet_recv(&links[1-p], now, peers[p]);
+                if (peers[p]->frame >= HNET_MATCH_FRAMES) {
+                    continue;
+                }
+
+                if (!pending[p])
+                {
+                    input[p] = hnet_input(&inrng[p]);
+                    pending[p] = 1;
+                }
+                if (tetris_rollback_advance(peers[p], input[p]) == TETRIS_ERROR_ROLLBACK_STALL)
+                {
+                    stalls++;
+                    continue;
+                }
+                hnet_send(&links[p], now, p, peers[p]->frame - 1, input[p]);
+                pending[p] = 0;
+            }
+            now++;
+        }
+
+        // Deliver everything, then one more empty frame applies the last rollbacks
+        for (int p = 0; p < 2; p++) {
+            hnet_recv(&links[1-p], INT32_MAX, peers[p]);
+        }
+        for (int p = 0; p < 2; p++)
+        {
+            tetris_rollback_advance(peers[p], 0);
+            hnet_send(&links[p], now, p, peers[p]->frame - 1, 0);
+        }
+        for (int p = 0; p < 2; p++) {
+            hnet_recv(&links[1-p], INT32_MAX, peers[p]);
+        }
+
+        desyncs += !hnet_same(peers[0], peers[1]);
+        for (int p = 0; p < 2; p++)
+        {
+            frames += peers[p]->frame;
+            resims += peers[p]->resims;
+            rollbacks += peers[p]->rollbacks;
+        }
+        matches++;
+    }
+    tend = hnet_cputime();
+
+    printf("latency %d jitter %d frames, window %d frames\n", latency, jitter, TETRIS_ROLLBACK_FRAMES);
+    printf("%lu matches, %lu desyncs, %lu stalls\n", (unsigned long)matches, (unsigned long)desyncs, (unsigned long)stalls);
+    printf("frames/s %.0f, rollback frames/s %.0f, %.2f frames per rollback\n",
+        frames * 1e6 / (tend - tstart), resims * 1e6 / (tend - tstart), rollbacks ? (double)resims / rollbacks : 0.0);
+
+    hnet_link_free(&links[0]);
+    hnet_link_free(&links[1]);
+    free(peers[0]);
+    free(peers[1]);
+
+    return desyncs ? 1 : 0;
+}
+
+
+// --- Private Function Definitions --- //
+
+tetris_input_t hnet_input(tetris_rng_t* rng)
+{
+    uint32_t r = tetris_rng_next(rng);
+
+    // Hard drop about every 30 frames, other keys about every 6 frames
+    if (r % 30 == 0) {
+        return TETRIS_INPUT(TETRIS_CMD_HDROP);
+    }
+    if ((r >> 8) % 6 == 0) {
+        return TETRIS_INPUT((r >> 16) % TETRIS_CMD_HDROP);
+    }
+
+    return 0;
+}
+
+int hnet_same(const tetris_rollback_t* a, const tetris_rollback_t* b)
+{
+    if (a->frame != b->frame) {
+        return 0;
+    }
+
+    for (int i = 0; i < a->count; i++)
+    {
+        const tetris_game_t* ga = &a->games[i];
+        const tetris_game_t* gb = &b->games[i];
+
+        if (memcmp(&a->boards[i], &b->boards[i], sizeof(tetris_board_t))) {
+            return 0;
+        }
+        if (ga->score != gb->score || ga->level != gb->level || ga->isGameover != gb->isGameover || ga->pphead != gb->pphead) {
+            return 0;
+        }
+        if (memcmp(&ga->bag, &gb->bag, sizeof(tetris_bag_t)) || memcmp(ga->ppreview, gb->ppreview, sizeof(ga->ppreview))) {
+            return 0;
+        }
+        if (a->match.players[i].pending != b->match.players[i].pending || a->match.players[i].received != b->match.players[i].received) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+uint64_t hnet_cputime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,60 @@
+#include <stdint.h>
+#include "btetris_rng.h"
+#include "btetris_rollback.h"
+
+#ifndef __HNET__
+#define __HNET__
+
+// Input message between peers
+typedef struct hnet_msg {
+    int32_t         deliver;    // Frame the message arrives at
+    int32_t         frame;      // Frame of the input
+    int8_t          player;     // Player the input belongs to
+    tetris_input_t  input;
+} hnet_msg_t;
+
+// One way loopback link, delays every message by a latency plus random jitter in frames. Jitter can reorder messages.
+typedef struct hnet_link {
+    hnet_msg_t*     msgs;       // Messages in flight
+    int32_t         len;
+    int32_t         cap;
+    int32_t         latency;    // Frames every message is delayed
+    int32_t         jitter;     // Extra random delay, [0:jitter] frames
+    tetris_rng_t    rng;
+} hnet_link_t;
+
+
+/// @brief Allocates a link
+/// @param link Link object
+/// @param latency Frames every message is delayed
+/// @param jitter Maximum extra delay in frames
+/// @param seed Seed for the jitter
+/// @return 0 on success, -1 if out of memory
+int hnet_link_init(hnet_link_t* link, int32_t latency, int32_t jitter, uint64_t seed);
+
+/// @brief Frees a link
+/// @param link Link object
+void hnet_link_free(hnet_link_t* link);
+
+/// @brief Sends an input over a link
+/// @param link Link object
+/// @param now Current frame
+/// @param player Player the input belongs to
+/// @param frame Frame of the input
+/// @param input Input
+/// @return 0 on success, -1 if out of memory
+int hnet_send(hnet_link_t* link, int32_t now, int8_t player, int32_t frame, tetris_input_t input);
+
+/// @brief Passes every message that arrived by now to a session
+/// @param link Link object
+/// @param now Current frame
+/// @param session Receiving session
+void hnet_recv(hnet_link_t* link, int32_t now, tetris_rollback_t* session);
+
+/// @brief Plays rollback sessions between two peers over loopback links and prints simulation throughput
+/// @param argc Argument count, arguments are [latency] [jitter] [seconds]
+/// @param argv Arguments
+/// @return Exit code
+int hnet_main(int argc, char** argv);
+
+#endif
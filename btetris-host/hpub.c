@@ -0,0 +1,194 @@
+#include "hpub.h"
+#include "btetris_control.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Writer of the benchmark
+typedef struct hpub_writer {
+    tetris_pub_t*   pub;
+    atomic_int      stop;
+    uint64_t        count;      // Frames published
+    uint64_t        tpub;       // Nanoseconds spent publishing
+    uint64_t        tmax;       // Longest publish in nanoseconds
+} hpub_writer_t;
+
+
+// --- Private Functions --- //
+
+/// @brief Ticks a game with random inputs and publishes every tick, a thousand times a second until stopped
+/// @param arg Writer state
+/// @return NULL
+void* hpub_write(void* arg);
+
+/// @brief Gets monotonic time in nanoseconds
+/// @return Time
+uint64_t hpub_now();
+
+
+// --- Public Functions --- //
+
+const tetris_pub_t* hpub_open(const char* name)
+{
+    const tetris_pub_t* pub;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    pub = mmap(NULL, sizeof(tetris_pub_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return (pub == MAP_FAILED) ? NULL : pub;
+}
+
+int hpub_main(int argc, char** argv)
+{
+    const char* name = (argc > 1 && argv[1][0] == '/') ? argv[1] : NULL;
+    int seconds = (argc > (name ? 2 : 1)) ? atoi(argv[name ? 2 : 1]) : 5;
+
+    const tetris_pub_t* pub;
+    tetris_frame_t frame;
+    hpub_writer_t writer;
+    pthread_t thread;
+    uint64_t reads = 0, busy = 0, fresh = 0, tread = 0, tmax = 0, tstart, t;
+    uint32_t last = 0;
+
+    // Frames of a running demo, printed every second
+    if (name)
+    {
+        pub = hpub_open(name);
+        if (!pub)
+        {
+            perror("shm_open");
+            return 1;
+        }
+
+        for (int i = 0; i < seconds; i++)
+        {
+            if (tetris_pub_read(pub, &frame) != TETRIS_SUCCESS)
+            {
+                printf("publisher busy, it may have died mid publish\n");
+                sleep(1);
+                continue;
+            }
+            printf("frame %u: score %ld level %d height %d piece %d, %u frames since last\n",
+                frame.seq, (long)frame.score, frame.level, frame.pf_height, frame.fcol, frame.seq - last);
+            last = frame.seq;
+            sleep(1);
+        }
+        munmap((void*)pub, sizeof(tetris_pub_t));
+
+        return 0;
+    }
+
+    // Writer publishes a thousand times a second, the reader copies the newest frame at a renderer's rate
+    memset(&writer, 0, sizeof(writer));
+    writer.pub = aligned_alloc(TETRIS_CACHE_LINE, sizeof(tetris_pub_t));
+    if (!writer.pub)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    tetris_pub_init(writer.pub);
+    if (pthread_create(&thread, NULL, hpub_write, &writer))
+    {
+        fprintf(stderr, "failed to start writer\n");
+        return 1;
+    }
+
+    tstart = hpub_now();
+    while ((t = hpub_now()) - tstart < (uint64_t)seconds * 1000000000)
+    {
+        usleep(4167);
+        if (tetris_pub_count(writer.pub) == last) {
+            continue;
+        }
+
+        t = hpub_now();
+        if (tetris_pub_read(writer.pub, &frame) != TETRIS_SUCCESS)
+        {
+            busy++;
+            continue;
+        }
+        t = hpub_now() - t;
+        tread += t;
+        if (t > tmax) {
+            tmax = t;
+        }
+        reads++;
+        fresh += frame.seq - last;
+        last = frame.seq;
+    }
+    atomic_store(&writer.stop, 1);
+    pthread_join(thread, NULL);
+
+    printf("published %lu frames, %.0f ns per publish, longest %.1f us\n",
+        (unsigned long)writer.count, writer.count ? (double)writer.tpub / writer.count : 0.0, writer.tmax / 1000.0);
+    printf("read %lu frames, %.0f ns per read, longest %.1f us, %lu frames published in between were skipped, %lu reads gave up\n",
+        (unsigned long)reads, reads ? (double)tread / reads : 0.0, tmax / 1000.0, (unsigned long)(fresh - reads), (unsigned long)busy);
+    free(writer.pub);
+
+    return 0;
+}
+
+
+// --- Private Function Definitions --- //
+
+void* hpub_write(void* arg)
+{
+    hpub_writer_t* writer = arg;
+    tetris_game_t game;
+    tetris_board_t board;
+    tetris_rng_t rng;
+    uint64_t t;
+
+    tetris_init(&game, &board, 1);
+    tetris_start(&game);
+    tetris_rng_seed(&rng, 1);
+
+    while (!atomic_load_explicit(&writer->stop, memory_order_relaxed))
+    {
+        switch (tetris_rng_next(&rng) % 16)
+        {
+            case 0: tetris_leftshift(&game); break;
+            case 1: tetris_rightshift(&game); break;
+            case 2: tetris_rotcw(&game); break;
+            case 3: tetris_hdrop(&game); break;
+        }
+        if (tetris_tick(&game, 10000) == TETRIS_ERROR_GAME_OVER)
+        {
+            tetris_reset(&game);
+            tetris_start(&game);
+        }
+
+        t = hpub_now();
+        tetris_publish(writer->pub, &game);
+        t = hpub_now() - t;
+
+        writer->count++;
+        writer->tpub += t;
+        if (t > writer->tmax) {
+            writer->tmax = t;
+        }
+        usleep(1000);
+    }
+
+    return NULL;
+}
+
+uint64_t hpub_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
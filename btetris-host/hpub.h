@@ -0,0 +1,19 @@
+#include <stdint.h>
+#include "btetris_publish.h"
+
+#ifndef __HPUB__
+#define __HPUB__
+
+/// @brief Maps a publication created by `tetrisd -p /name` read-only
+/// @param name Name of the shared memory object
+/// @return Publication, NULL on failure
+const tetris_pub_t* hpub_open(const char* name);
+
+/// @brief Watches a publication. Without a name, a writer thread publishes a game a thousand times a second and
+/// the read and publish costs are printed, otherwise frames published by `tetrisd -p /name` are printed.
+/// @param argc Argument count, arguments are [name] [seconds]. Names start with a slash.
+/// @param argv Arguments
+/// @return Exit code
+int hpub_main(int argc, char** argv);
+
+#endif
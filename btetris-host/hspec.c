@@ -0,0 +1,700 @@
+#define _GNU_SOURCE
+#include "hspec.h"
+#include "hversus.h"
+#include "btetris_control.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// Microseconds per tick of the benchmark
+#define HSPEC_PERIOD 16667
+
+// Read buffer of a client stand-in, holds at least one whole frame
+#define HSPEC_RBUF 1024
+
+// Spectator stand-in of the benchmark
+typedef struct hspec_client {
+    int                     fd;
+    int32_t                 game;
+    int32_t                 len;            // Bytes in buf
+    uint8_t                 buf[HSPEC_RBUF];
+    tetris_stream_state_t   state;
+} hspec_client_t;
+
+// Client threads of the benchmark
+typedef struct hspec_bench {
+    const char*     path;
+    hspec_client_t* clients;
+    int32_t         nclients;
+    int32_t         nslow;      // Clients at the end of the array that subscribe but never read
+    int32_t         ngames;
+    atomic_int      connected;  // Number of clients connected and subscribed
+    atomic_int      stop;
+    uint64_t        frames;     // Frames decoded
+    uint64_t        errors;     // Frames that failed to decode
+} hspec_bench_t;
+
+
+// --- Private Functions --- //
+
+/// @brief Accepts every pending connection
+/// @param spec Server object
+void hspec_accept(hspec_t* spec);
+
+/// @brief Closes a subscriber and releases its queued frames
+/// @param spec Server object
+/// @param sub Subscriber
+void hspec_drop(hspec_t* spec, hspec_sub_t* sub);
+
+/// @brief Reads the subscription of a client, or notices it closed the connection
+/// @param spec Server object
+/// @param sub Subscriber
+/// @return 0 on success, -1 if the subscriber has to be dropped
+int hspec_read(hspec_t* spec, hspec_sub_t* sub);
+
+/// @brief Writes queued frames until the socket is full, gathered into one writev() call
+/// @param spec Server object
+/// @param sub Subscriber
+/// @return 0 on success, -1 if the subscriber has to be dropped
+int hspec_flush(hspec_t* spec, hspec_sub_t* sub);
+
+/// @brief Drops one reference to a frame, frees it after the last one
+/// @param buf Frame
+void hspec_release(hspec_buf_t* buf);
+
+/// @brief Presses at most one key for a game's bot, heading for the placement `hversus_bot()` picked
+/// @param hgame Game
+void hspec_play(hspec_game_t* hgame);
+
+/// @brief Connects every client stand-in, then reads and decodes frames until stopped
+/// @param arg Benchmark state
+/// @return NULL
+void* hspec_clients(void* arg);
+
+/// @brief Reads and decodes every complete frame available on a client socket
+/// @param bench Benchmark state
+/// @param client Client stand-in
+void hspec_client_read(hspec_bench_t* bench, hspec_client_t* client);
+
+/// @brief Gets CPU time used by the calling thread in microseconds
+/// @return Time
+uint64_t hspec_cputime();
+
+
+// --- Public Functions --- //
+
+int hspec_init(hspec_t* spec, const char* path, int32_t ngames, uint64_t seed)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    memset(spec, 0, sizeof(hspec_t));
+    spec->lfd = -1;
+    spec->efd = -1;
+
+    if (ngames < 1 || strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    spec->games = malloc(ngames * sizeof(hspec_game_t));
+    spec->out = calloc(ngames, sizeof(hspec_buf_t*));
+    if (!spec->games || !spec->out)
+    {
+        hspec_destroy(spec);
+        return -1;
+    }
+    spec->ngames = ngames;
+
+    for (int32_t i = 0; i < ngames; i++)
+    {
+        hspec_game_t* hgame = &spec->games[i];
+
+        tetris_init(&hgame->game, &hgame->board, (int32_t)tetris_rng_mix64(seed + i));
+        tetris_start(&hgame->game);
+        tetris_stream_init(&hgame->stream, 0);
+        tetris_rng_seed(&hgame->rng, seed + i);
+        hgame->planned = 0;
+    }
+
+    // Non-blocking listening socket, registered with a NULL pointer to tell it apart from subscribers
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    spec->lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    spec->efd = epoll_create1(EPOLL_CLOEXEC);
+    if (spec->lfd < 0 || spec->efd < 0 ||
+        bind(spec->lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(spec->lfd, SOMAXCONN) < 0)
+    {
+        hspec_destroy(spec);
+        return -1;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(spec->efd, EPOLL_CTL_ADD, spec->lfd, &ev) < 0)
+    {
+        hspec_destroy(spec);
+        return -1;
+    }
+
+    return 0;
+}
+
+void hspec_destroy(hspec_t* spec)
+{
+    while (spec->nsubs) {
+        hspec_drop(spec, spec->subs[spec->nsubs - 1]);
+    }
+    free(spec->subs);
+    spec->subs = NULL;
+    spec->cap = 0;
+
+    if (spec->lfd >= 0) {
+        close(spec->lfd);
+    }
+    if (spec->efd >= 0) {
+        close(spec->efd);
+    }
+    spec->lfd = -1;
+    spec->efd = -1;
+
+    free(spec->games);
+    free(spec->out);
+    spec->games = NULL;
+    spec->out = NULL;
+    spec->ngames = 0;
+}
+
+void hspec_poll(hspec_t* spec, int timeout)
+{
+    struct epoll_event evs[256];
+    hspec_sub_t* sub;
+    int n;
+
+    do
+    {
+        n = epoll_wait(spec->efd, evs, 256, timeout);
+        for (int i = 0; i < n; i++)
+        {
+            sub = evs[i].data.ptr;
+            if (!sub)
+            {
+                hspec_accept(spec);
+                continue;
+            }
+
+            if ((evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && hspec_read(spec, sub) < 0)
+            {
+                hspec_drop(spec, sub);
+                continue;
+            }
+            if ((evs[i].events & EPOLLOUT) && hspec_flush(spec, sub) < 0) {
+                hspec_drop(spec, sub);
+            }
+        }
+
+        // Only the first wait blocks, then events are drained
+        timeout = 0;
+    } while (n == 256);
+}
+
+void hspec_tick(hspec_t* spec, uint64_t tmicro)
+{
+    uint8_t frame[TETRIS_STREAM_MAX];
+    hspec_game_t* hgame;
+    hspec_buf_t* buf;
+    hspec_sub_t* sub;
+    int32_t len;
+
+    // Encode every game once, the server holds one reference until every subscriber queued it
+    for (int32_t i = 0; i < spec->ngames; i++)
+    {
+        hgame = &spec->games[i];
+
+        hspec_play(hgame);
+        if (tetris_tick(&hgame->game, tmicro) == TETRIS_ERROR_GAME_OVER || hgame->game.isGameover)
+        {
+            tetris_reset(&hgame->game);
+            tetris_start(&hgame->game);
+            hgame->planned = 0;
+        }
+
+        spec->out[i] = NULL;
+        len = tetris_stream_encode(&hgame->stream, &hgame->game, frame);
+        if (!len) {
+            continue;
+        }
+
+        // The encoder already counts a dropped frame as sent, the next frame must not be a delta against it
+        buf = malloc(sizeof(hspec_buf_t) + 2 + len);
+        if (!buf)
+        {
+            tetris_stream_keyframe(&hgame->stream);
+            continue;
+        }
+        buf->refs = 1;
+        buf->len = 2 + len;
+        buf->data[0] = (uint8_t)len;
+        buf->data[1] = (uint8_t)(len >> 8);
+        memcpy(&buf->data[2], frame, len);
+
+        spec->out[i] = buf;
+        spec->frames++;
+    }
+
+    // Queue each frame for its subscribers, walking backwards so dropping a subscriber doesn't skip one
+    for (int32_t i = spec->nsubs - 1; i >= 0; i--)
+    {
+        sub = spec->subs[i];
+        if (sub->game < 0 || !(buf = spec->out[sub->game])) {
+            continue;
+        }
+
+        // Frames before the first keyframe can't be decoded
+        if (!sub->synced)
+        {
+            if (!(buf->data[2] & TETRIS_STREAM_KEY)) {
+                continue;
+            }
+            sub->synced = 1;
+        }
+
+        if (sub->qlen == HSPEC_QUEUE)
+        {
+            spec->drops++;
+            hspec_drop(spec, sub);
+            continue;
+        }
+        buf->refs++;
+        sub->queue[(sub->qhead + sub->qlen) % HSPEC_QUEUE] = buf;
+        sub->qlen++;
+
+        // Sockets that were full are flushed once epoll reports them writable
+        if (!sub->waiting && hspec_flush(spec, sub) < 0) {
+            hspec_drop(spec, sub);
+        }
+    }
+
+    for (int32_t i = 0; i < spec->ngames; i++)
+    {
+        if (spec->out[i]) {
+            hspec_release(spec->out[i]);
+        }
+    }
+    spec->ticks++;
+}
+
+int hspec_main(int argc, char** argv)
+{
+    int32_t ngames = (argc > 1) ? atoi(argv[1]) : 100;
+    int32_t nclients = (argc > 2) ? atoi(argv[2]) : 2000;
+    int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+    int32_t nslow = (argc > 4) ? atoi(argv[4]) : 10;
+
+    char path[64];
+    hspec_t spec;
+    hspec_bench_t bench;
+    pthread_t thread;
+    struct rlimit lim;
+    struct timespec deadline, now;
+    uint64_t cpu, synced = 0, desyncs = 0, ticks;
+    int64_t wait;
+
+    if (ngames < 1 || nclients < 1 || nslow < 0 || nslow > nclients)
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    // Both ends of every connection live in this process
+    getrlimit(RLIMIT_NOFILE, &lim);
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+    if ((uint64_t)2 * nclients + 16 > lim.rlim_cur)
+    {
+        fprintf(stderr, "too many clients for the open file limit %lu\n", (unsigned long)lim.rlim_cur);
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "/tmp/tetrish-spec-%d.sock", (int)getpid());
+    if (hspec_init(&spec, path, ngames, 1) < 0)
+    {
+        fprintf(stderr, "failed to create server\n");
+        return 1;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.path = path;
+    bench.nclients = nclients;
+    bench.nslow = nslow;
+    bench.ngames = ngames;
+    bench.clients = calloc(nclients, sizeof(hspec_client_t));
+    if (!bench.clients || pthread_create(&thread, NULL, hspec_clients, &bench))
+    {
+        fprintf(stderr, "failed to start clients\n");
+        return 1;
+    }
+
+    // Accept every client before the clock starts
+    while (atomic_load(&bench.connected) < nclients) {
+        hspec_poll(&spec, 10);
+    }
+    hspec_poll(&spec, 10);
+
+    // Ticks at a fixed rate, waiting for socket events in between
+    cpu = hspec_cputime();
+    ticks = (uint64_t)seconds * 1000000 / HSPEC_PERIOD;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    for (uint64_t t = 0; t < ticks; t++)
+    {
+        hspec_tick(&spec, HSPEC_PERIOD);
+
+        deadline.tv_nsec += HSPEC_PERIOD * 1000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        do
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            wait = (deadline.tv_sec - now.tv_sec) * 1000 + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+            hspec_poll(&spec, (wait > 0) ? (int)wait : 0);
+        } while (wait > 0);
+    }
+    cpu = hspec_cputime() - cpu;
+
+    // Let clients catch up, then compare what they decoded with what was sent
+    for (int i = 0; i < 20; i++) {
+        hspec_poll(&spec, 10);
+    }
+    atomic_store(&bench.stop, 1);
+    pthread_join(thread, NULL);
+
+    for (int32_t i = 0; i < nclients - nslow; i++)
+    {
+        hspec_client_t* client = &bench.clients[i];
+        tetris_stream_state_t* sent = &spec.games[client->game].stream.sent;
+
+        if (!client->state.valid) {
+            continue;
+        }
+        synced++;
+        desyncs += memcmp(client->state.board.pf, sent->board.pf, sizeof(sent->board.pf)) ||
+            memcmp(client->state.board.fpos, sent->board.fpos, sizeof(sent->board.fpos)) || client->state.score != sent->score;
+    }
+
+    printf("games %d clients %d (%d slow) ticks %lu\n", ngames, nclients, nslow, (unsigned long)spec.ticks);
+    printf("frames encoded/s %.0f, delivered/s %.0f, %.2f frames per write, %.0f bytes/s\n",
+        spec.frames * 1e6 / (ticks * HSPEC_PERIOD), spec.sent * 1e6 / (ticks * HSPEC_PERIOD),
+        spec.writes ? (double)spec.sent / spec.writes : 0.0, spec.bytes * 1e6 / (ticks * HSPEC_PERIOD));
+    printf("server cpu %.1f us/tick (%.1f%% of a core), dropped %lu\n", (double)cpu / ticks, 100.0 * cpu / (ticks * HSPEC_PERIOD), (unsigned long)spec.drops);
+    printf("clients synced %lu, desyncs %lu, decode errors %lu, frames decoded %lu\n",
+        (unsigned long)synced, (unsigned long)desyncs, (unsigned long)bench.errors, (unsigned long)bench.frames);
+
+    for (int32_t i = 0; i < nclients; i++)
+    {
+        if (bench.clients[i].fd >= 0) {
+            close(bench.clients[i].fd);
+        }
+    }
+    hspec_destroy(&spec);
+    unlink(path);
+    free(bench.clients);
+
+    return (desyncs || bench.errors) ? 1 : 0;
+}
+
+
+// --- Private Function Definitions --- //
+
+void hspec_accept(hspec_t* spec)
+{
+    struct epoll_event ev;
+    hspec_sub_t* sub;
+    hspec_sub_t** subs;
+    int fd, sndbuf = HSPEC_SNDBUF;
+
+    while ((fd = accept4(spec->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        if (spec->nsubs == spec->cap)
+        {
+            subs = realloc(spec->subs, (spec->cap ? 2 * spec->cap : 64) * sizeof(hspec_sub_t*));
+            if (!subs)
+            {
+                close(fd);
+                continue;
+            }
+            spec->subs = subs;
+            spec->cap = spec->cap ? 2 * spec->cap : 64;
+        }
+
+        sub = calloc(1, sizeof(hspec_sub_t));
+        if (!sub)
+        {
+            close(fd);
+            continue;
+        }
+        sub->fd = fd;
+        sub->game = -1;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = sub;
+        if (epoll_ctl(spec->efd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            close(fd);
+            free(sub);
+            continue;
+        }
+
+        sub->idx = spec->nsubs;
+        spec->subs[spec->nsubs++] = sub;
+    }
+}
+
+void hspec_drop(hspec_t* spec, hspec_sub_t* sub)
+{
+    hspec_sub_t* last = spec->subs[spec->nsubs - 1];
+
+    // Closing the socket also removes it from epoll
+    close(sub->fd);
+    for (int i = 0; i < sub->qlen; i++) {
+        hspec_release(sub->queue[(sub->qhead + i) % HSPEC_QUEUE]);
+    }
+
+    last->idx = sub->idx;
+    spec->subs[sub->idx] = last;
+    spec->nsubs--;
+    free(sub);
+}
+
+int hspec_read(hspec_t* spec, hspec_sub_t* sub)
+{
+    uint32_t game;
+    uint8_t tmp[64];
+    ssize_t n;
+
+    if (sub->game < 0)
+    {
+        n = read(sub->fd, &game, sizeof(game));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return 0;
+        }
+        if (n != sizeof(game) || game >= (uint32_t)spec->ngames) {
+            return -1;
+        }
+
+        // Everyone watching the game gets the keyframe the new subscriber needs
+        sub->game = game;
+        tetris_stream_keyframe(&spec->games[game].stream);
+        return 0;
+    }
+
+    // Subscribers don't send anything else, reading 0 bytes means the client closed the connection
+    n = read(sub->fd, tmp, sizeof(tmp));
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+
+    return n ? 0 : -1;
+}
+
+int hspec_flush(hspec_t* spec, hspec_sub_t* sub)
+{
+    struct iovec iov[HSPEC_QUEUE];
+    struct epoll_event ev;
+    hspec_buf_t* buf;
+    ssize_t n;
+
+    if (sub->qlen)
+    {
+        for (int i = 0; i < sub->qlen; i++)
+        {
+            buf = sub->queue[(sub->qhead + i) % HSPEC_QUEUE];
+            iov[i].iov_base = buf->data + (i ? 0 : sub->off);
+            iov[i].iov_len = buf->len - (i ? 0 : sub->off);
+        }
+
+        n = writev(sub->fd, iov, sub->qlen);
+        spec->writes++;
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return -1;
+        }
+
+        // Release every frame that was written completely
+        if (n > 0)
+        {
+            spec->bytes += n;
+            n += sub->off;
+            while (sub->qlen && n >= sub->queue[sub->qhead]->len)
+            {
+                n -= sub->queue[sub->qhead]->len;
+                hspec_release(sub->queue[sub->qhead]);
+                sub->qhead = (sub->qhead + 1) % HSPEC_QUEUE;
+                sub->qlen--;
+                spec->sent++;
+            }
+            sub->off = (int32_t)n;
+        }
+    }
+
+    // Only ask for writability while frames are left, otherwise epoll would report it every poll
+    if (!!sub->qlen != sub->waiting)
+    {
+        sub->waiting = !!sub->qlen;
+        ev.events = EPOLLIN | (sub->waiting ? EPOLLOUT : 0);
+        ev.data.ptr = sub;
+        epoll_ctl(spec->efd, EPOLL_CTL_MOD, sub->fd, &ev);
+    }
+
+    return 0;
+}
+
+void hspec_release(hspec_buf_t* buf)
+{
+    if (--buf->refs == 0) {
+        free(buf);
+    }
+}
+
+void hspec_play(hspec_game_t* hgame)
+{
+    tetris_game_t* game = &hgame->game;
+    tetris_board_t* board = game->board;
+
+    // Bot presses a key about every 8 ticks
+    if (board->fcol == TETRIS_BLANK || tetris_rng_next(&hgame->rng) % 8) {
+        return;
+    }
+
+    if (!hgame->planned)
+    {
+        if (hversus_bot(game, &hgame->rot, &hgame->col) < 0) {
+            return;
+        }
+        hgame->planned = 1;
+    }
+
+    if (board->frot != hgame->rot) {
+        tetris_rotcw(game);
+    }
+    else if (board->fpos[0].w < hgame->col) {
+        tetris_rightshift(game);
+    }
+    else if (board->fpos[0].w > hgame->col) {
+        tetris_leftshift(game);
+    }
+    else
+    {
+        tetris_hdrop(game);
+        hgame->planned = 0;
+    }
+}
+
+void* hspec_clients(void* arg)
+{
+    hspec_bench_t* bench = arg;
+    struct sockaddr_un addr;
+    struct epoll_event ev, evs[256];
+    int efd, n;
+    uint32_t game;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, bench->path);
+    efd = epoll_create1(EPOLL_CLOEXEC);
+
+    for (int32_t i = 0; i < bench->nclients; i++)
+    {
+        hspec_client_t* client = &bench->clients[i];
+
+        client->game = i % bench->ngames;
+        client->len = 0;
+        tetris_stream_state_init(&client->state);
+
+        client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (client->fd < 0 || connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        {
+            fprintf(stderr, "client %d failed to connect\n", i);
+            exit(1);
+        }
+        game = client->game;
+        if (write(client->fd, &game, sizeof(game)) != sizeof(game)) {
+            exit(1);
+        }
+        fcntl(client->fd, F_SETFL, O_NONBLOCK);
+
+        // Slow clients are never read from
+        if (i < bench->nclients - bench->nslow)
+        {
+            ev.events = EPOLLIN;
+            ev.data.ptr = client;
+            epoll_ctl(efd, EPOLL_CTL_ADD, client->fd, &ev);
+        }
+        atomic_fetch_add(&bench->connected, 1);
+    }
+
+    while (!atomic_load(&bench->stop))
+    {
+        n = epoll_wait(efd, evs, 256, 10);
+        for (int i = 0; i < n; i++) {
+            hspec_client_read(bench, evs[i].data.ptr);
+        }
+    }
+
+    // Read whatever arrived after the last wait
+    for (int32_t i = 0; i < bench->nclients - bench->nslow; i++) {
+        hspec_client_read(bench, &bench->clients[i]);
+    }
+    close(efd);
+
+    return NULL;
+}
+
+void hspec_client_read(hspec_bench_t* bench, hspec_client_t* client)
+{
+    ssize_t n;
+    int32_t p, len;
+
+    while ((n = read(client->fd, client->buf + client->len, HSPEC_RBUF - client->len)) > 0)
+    {
+        client->len += n;
+
+        // Decode every complete frame, keep the partial one at the start of the buffer
+        p = 0;
+        while (client->len - p >= 2 && client->len - p >= 2 + (len = client->buf[p] | client->buf[p+1] << 8))
+        {
+            if (tetris_stream_decode(&client->state, &client->buf[p+2], len) == TETRIS_SUCCESS) {
+                bench->frames++;
+            }
+            else {
+                bench->errors++;
+            }
+            p += 2 + len;
+        }
+        memmove(client->buf, client->buf + p, client->len - p);
+        client->len -= p;
+    }
+}
+
+uint64_t hspec_cputime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
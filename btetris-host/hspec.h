@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include "btetris_game.h"
+#include "btetris_rng.h"
+#include "btetris_stream.h"
+
+#ifndef __HSPEC__
+#define __HSPEC__
+
+// Number of frames queued for a subscriber before it is dropped as too slow
+#define HSPEC_QUEUE 64
+
+// Kernel send buffer of each subscriber socket, keeps memory per subscriber small so slow readers are found early
+#define HSPEC_SNDBUF 4096
+
+// Frame shared by every subscriber of a game, freed once the last one has written it
+typedef struct hspec_buf {
+    int32_t refs;       // Number of subscriber queues holding this frame
+    int32_t len;        // Bytes in data, including the 2 byte length prefix
+    uint8_t data[];
+} hspec_buf_t;
+
+// Game served to spectators, played by a bot
+typedef struct hspec_game {
+    tetris_game_t   game;
+    tetris_board_t  board;
+    tetris_stream_t stream;
+    tetris_rng_t    rng;        // Decides when the bot presses a key
+    int8_t          planned;    // Set once rot and col were picked for the falling tetromino
+    int8_t          rot;        // Rotations the bot is heading for
+    int8_t          col;        // Column the bot is heading for
+} hspec_game_t;
+
+// Spectator connection
+typedef struct hspec_sub {
+    int             fd;
+    int32_t         idx;        // Index in the server's subscriber array
+    int32_t         game;       // Subscribed game, -1 until the client sent it
+    int8_t          synced;     // Set once a keyframe was queued, frames before it are skipped
+    int8_t          waiting;    // Set while waiting for the socket to become writable
+    hspec_buf_t*    queue[HSPEC_QUEUE];     // Ring buffer of frames to write, starting at qhead
+    int16_t         qhead;
+    int16_t         qlen;
+    int32_t         off;        // Bytes of the first frame already written
+} hspec_sub_t;
+
+/*
+ * Spectator server. Games are ticked and encoded once per tick, then the same frame is queued for every subscriber
+ * of the game. A client connects to the Unix socket and writes the index of the game it wants as a uint32_t,
+ * then reads frames, each prefixed by its length as a uint16_t.
+ */
+typedef struct hspec
+{
+    int                 lfd;        // Listening socket
+    int                 efd;        // epoll instance
+
+    hspec_game_t*       games;
+    hspec_buf_t**       out;        // Frame of each game in the current tick, NULL if nothing changed
+    int32_t             ngames;
+
+    hspec_sub_t**       subs;
+    int32_t             nsubs;
+    int32_t             cap;
+
+    // Statistics
+    uint64_t            ticks;
+    uint64_t            frames;     // Frames encoded
+    uint64_t            sent;       // Frames fully written to a subscriber
+    uint64_t            bytes;      // Bytes written to subscribers
+    uint64_t            writes;     // write() calls
+    uint64_t            drops;      // Subscribers dropped for being too slow
+} hspec_t;
+
+
+/// @brief Creates the listening socket and the games
+/// @param spec Server object
+/// @param path Path of the Unix socket, replaced if it exists
+/// @param ngames Number of games
+/// @param seed Seed for the games
+/// @return 0 on success, -1 otherwise
+int hspec_init(hspec_t* spec, const char* path, int32_t ngames, uint64_t seed);
+
+/// @brief Closes every connection and frees the games
+/// @param spec Server object
+void hspec_destroy(hspec_t* spec);
+
+/// @brief Accepts new subscribers, reads subscriptions and writes queued frames to sockets that became writable
+/// @param spec Server object
+/// @param timeout Milliseconds to wait for events, 0 returns right away
+void hspec_poll(hspec_t* spec, int timeout);
+
+/// @brief Ticks every game, encodes each game's changes once and queues them for its subscribers
+/// @param spec Server object
+/// @param tmicro Microseconds since the last tick
+void hspec_tick(hspec_t* spec, uint64_t tmicro);
+
+/// @brief Serves bots to local client threads over a Unix socket and prints fan-out throughput
+/// @param argc Argument count, arguments are [games] [clients] [seconds] [slow clients]
+/// @param argv Arguments
+/// @return Exit code
+int hspec_main(int argc, char** argv);
+
+#endif
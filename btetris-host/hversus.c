@@ -0,0 +1,192 @@
+#include "hversus.h"
+#include "btetris_control.h"
+#include "btetris_versus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Matches still running after this many pieces per player end in a draw
+#define HVERSUS_MAX_PIECES 2000
+
+
+// --- Private Functions --- //
+
+/// @brief Scores a playfield for the bot, higher is better
+/// @param board Board object
+/// @param lines Rows cleared by the placement
+/// @return Score
+int hversus_eval(const tetris_board_t* board, int lines);
+
+/// @brief Moves the falling tetromino to a placement and hard drops it
+/// @param game Game object
+/// @param rot Number of clockwise rotations
+/// @param col Column of the tetromino's first block after rotating
+void hversus_place(tetris_game_t* game, int8_t rot, int8_t col);
+
+/// @brief Gets monotonic time in microseconds
+/// @return Time
+uint64_t hversus_now();
+
+
+// --- Public Functions --- //
+
+int hversus_bot(const tetris_game_t* game, int8_t* rot, int8_t* col)
+{
+    tetris_game_t tgame;
+    tetris_board_t tboard;
+    int score, best = 0;
+    int found = -1;
+
+    for (int8_t r = 0; r < 4; r++)
+    {
+        for (int8_t c = 0; c < TETRIS_WIDTH; c++)
+        {
+            tgame = *game;
+            tboard = *game->board;
+            tgame.board = &tboard;
+            tgame.journal = NULL;
+
+            if (tetris_step(&tgame, game->board->fcol, r, c) != TETRIS_SUCCESS) {
+                continue;
+            }
+
+            score = hversus_eval(&tboard, tgame.lclear.lines);
+            if (found < 0 || score > best)
+            {
+                best = score;
+                *rot = r;
+                *col = c;
+                found = 0;
+            }
+        }
+    }
+
+    return found;
+}
+
+int hversus_main(int argc, char** argv)
+{
+    int8_t players = (argc > 1) ? atoi(argv[1]) : 2;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 5;
+
+    tetris_versus_t match;
+    tetris_game_t games[TETRIS_VERSUS_PLAYERS];
+    tetris_board_t boards[TETRIS_VERSUS_PLAYERS];
+    tetris_game_t* gptrs[TETRIS_VERSUS_PLAYERS];
+    uint64_t matches = 0, draws = 0, pieces = 0, garbage = 0;
+    uint64_t tstart, tend;
+    int8_t rot, col;
+
+    if (players < 2 || players > TETRIS_VERSUS_PLAYERS)
+    {
+        fprintf(stderr, "players must be in [2:%d]\n", TETRIS_VERSUS_PLAYERS);
+        return 1;
+    }
+
+    for (int i = 0; i < players; i++)
+    {
+        tetris_init(&games[i], &boards[i], i + 1);
+        gptrs[i] = &games[i];
+    }
+
+    tstart = hversus_now();
+    tend = tstart + (uint64_t)seconds * 1000000;
+    while (hversus_now() < tend)
+    {
+        for (int i = 0; i < players; i++)
+        {
+            tetris_reset(&games[i]);
+            tetris_start(&games[i]);
+        }
+        tetris_versus_init(&match, gptrs, players, matches);
+
+        // Every player places one tetromino per tick
+        int n;
+        for (n = 0; n < HVERSUS_MAX_PIECES; n++)
+        {
+            for (int i = 0; i < players; i++)
+            {
+                if (match.players[i].alive && hversus_bot(&games[i], &rot, &col) == 0) {
+                    hversus_place(&games[i], rot, col);
+                }
+            }
+            pieces += match.alive;
+
+            if (tetris_versus_tick(&match, 1) == TETRIS_ERROR_GAME_OVER) {
+                break;
+            }
+        }
+
+        for (int i = 0; i < players; i++) {
+            garbage += match.players[i].received;
+        }
+        draws += (n == HVERSUS_MAX_PIECES);
+        matches++;
+    }
+    tend = hversus_now();
+
+    printf("players %d, %lu matches (%lu draws) in %.2f s\n", players, (unsigned long)matches, (unsigned long)draws, (tend - tstart) / 1e6);
+    printf("matches/s %.1f, pieces/s %.0f, garbage rows/s %.0f\n", matches * 1e6 / (tend - tstart), pieces * 1e6 / (tend - tstart), garbage * 1e6 / (tend - tstart));
+
+    return 0;
+}
+
+
+// --- Private Function Definitions --- //
+
+int hversus_eval(const tetris_board_t* board, int lines)
+{
+    int height[TETRIS_WIDTH];
+    int aggregate = 0, holes = 0, bumps = 0;
+
+    // Column heights and covered holes
+    for (int w = 0; w < TETRIS_WIDTH; w++)
+    {
+        height[w] = 0;
+        for (int h = board->pf_height; h >= 0; h--)
+        {
+            if (TETRIS_PF(board, h, w) == TETRIS_BLANK)
+            {
+                holes += (height[w] > 0);
+            }
+            else if (height[w] == 0) {
+                height[w] = h + 1;
+            }
+        }
+        aggregate += height[w];
+        if (w > 0) {
+            bumps += abs(height[w] - height[w-1]);
+        }
+    }
+
+    return 76*lines - 51*aggregate - 356*holes - 18*bumps;
+}
+
+void hversus_place(tetris_game_t* game, int8_t rot, int8_t col)
+{
+    tetris_cmd_t cmds[TETRIS_WIDTH + 1];
+    int n = 0;
+
+    for (int i = 0; i < rot; i++) {
+        cmds[n++] = TETRIS_CMD_ROTCW;
+    }
+    tetris_apply_inputs(game, cmds, n, NULL);
+
+    n = 0;
+    for (int w = game->board->fpos[0].w; w < col; w++) {
+        cmds[n++] = TETRIS_CMD_RIGHT;
+    }
+    for (int w = game->board->fpos[0].w; w > col; w--) {
+        cmds[n++] = TETRIS_CMD_LEFT;
+    }
+    cmds[n++] = TETRIS_CMD_HDROP;
+    tetris_apply_inputs(game, cmds, n, NULL);
+}
+
+uint64_t hversus_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,20 @@
+#include <stdint.h>
+#include "btetris_game.h"
+
+#ifndef __HVERSUS__
+#define __HVERSUS__
+
+/// @brief Picks a placement for the falling tetromino by trying every rotation and column on a copy of the game
+/// @param game Game object with a falling tetromino
+/// @param rot Set to the number of clockwise rotations
+/// @param col Set to the column of the tetromino's first block after rotating
+/// @return 0 if a placement was found, -1 otherwise
+int hversus_bot(const tetris_game_t* game, int8_t* rot, int8_t* col);
+
+/// @brief Plays versus matches between bots and prints match and garbage throughput
+/// @param argc Argument count, arguments are [players] [seconds]
+/// @param argv Arguments
+/// @return Exit code
+int hversus_main(int argc, char** argv);
+
+#endif
@@ -0,0 +1,137 @@
+#include "thost.h"
+#include "hversus.h"
+#include "hnet.h"
+#include "hspec.h"
+#include "hpub.h"
+#include "hbench.h"
+#include "btetris_control.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Per game state of the benchmark
+typedef struct hbench_game {
+    int8_t bot;     // Set to search every placement before each tick
+} hbench_game_t;
+
+// Ticks a game, bot games first search every placement of the falling tetromino on a copy of the game
+void hbench_step(void* user, tetris_game_t* game, uint64_t tmicro)
+{
+    hbench_game_t* hgame = user;
+
+    if (hgame->bot && game->board->fcol != TETRIS_BLANK)
+    {
+        tetris_game_t tgame;
+        tetris_board_t tboard;
+        int8_t best = TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF;
+
+        for (int8_t rot = 0; rot < 4; rot++)
+        {
+            for (int8_t col = 0; col < TETRIS_WIDTH; col++)
+            {
+                tgame = *game;
+                tboard = *game->board;
+                tgame.board = &tboard;
+                tgame.journal = NULL;
+
+                if (tetris_step(&tgame, game->board->fcol, rot, col) == TETRIS_SUCCESS && tboard.pf_height < best) {
+                    best = tboard.pf_height;
+                }
+            }
+        }
+    }
+
+    thost_tick(user, game, tmicro);
+}
+
+int main(int argc, char** argv)
+{
+    // Versus benchmark, `tetrish versus [players] [seconds]`
+    if (argc > 1 && strcmp(argv[1], "versus") == 0) {
+        return hversus_main(argc - 1, argv + 1);
+    }
+
+    // Rollback benchmark over loopback links, `tetrish rollback [latency] [jitter] [seconds]`
+    if (argc > 1 && strcmp(argv[1], "rollback") == 0) {
+        return hnet_main(argc - 1, argv + 1);
+    }
+
+    // Spectator fan-out benchmark, `tetrish spectate [games] [clients] [seconds] [slow clients]`
+    if (argc > 1 && strcmp(argv[1], "spectate") == 0) {
+        return hspec_main(argc - 1, argv + 1);
+    }
+
+    // Shared memory publication, `tetrish watch [name] [seconds]`
+    if (argc > 1 && strcmp(argv[1], "watch") == 0) {
+        return hpub_main(argc - 1, argv + 1);
+    }
+
+    // Gravity benchmark, `tetrish gravity [level] [tick microseconds] [seconds]`
+    if (argc > 1 && strcmp(argv[1], "gravity") == 0) {
+        return hbench_gravity_main(argc - 1, argv + 1);
+    }
+
+    // Wall collision benchmark, `tetrish wall [seconds]`
+    if (argc > 1 && strcmp(argv[1], "wall") == 0) {
+        return hbench_wall_main(argc - 1, argv + 1);
+    }
+
+    int nshards = (argc > 1) ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int32_t ngames = (argc > 2) ? atoi(argv[2]) : 10000;
+    int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+    int32_t nbots = (argc > 4) ? atoi(argv[4]) : 0;
+
+    thost_t host;
+    thost_stats_t stats;
+    hbench_game_t* hgames;
+    tetris_game_t* game;
+
+    if (thost_init(&host, nshards, ngames) != THOST_SUCCESS)
+    {
+        fprintf(stderr, "failed to create host\n");
+        return 1;
+    }
+
+    // Bots are all put on the first shard so it has more work than the others
+    hgames = calloc(ngames, sizeof(hbench_game_t));
+    if (!hgames)
+    {
+        fprintf(stderr, "out of memory\n");
+        thost_destroy(&host);
+        return 1;
+    }
+    for (int32_t i = 0; i < ngames; i++)
+    {
+        hgames[i].bot = (i % nshards == 0) && (i / nshards < nbots);
+        game = thost_add(&host, i + 1, &hgames[i]);
+        if (!game) {
+            break;
+        }
+        tetris_start(game);
+    }
+
+    // Run rounds back to back to measure throughput, every round starts once all shards finished the last one
+    thost_set_step(&host, hbench_step);
+    if (thost_start(&host, 10000, 0) != THOST_SUCCESS)
+    {
+        fprintf(stderr, "failed to start workers\n");
+        thost_destroy(&host);
+        free(hgames);
+        return 1;
+    }
+    sleep(seconds);
+    thost_stop(&host);
+
+    thost_stats(&host, &stats);
+    printf("shards %d games %d bots %d\n", nshards, ngames, nbots);
+    for (int i = 0; i < host.nshards; i++) {
+        printf("  shard %d: rounds %lu ticks %lu stolen %lu\n", i, (unsigned long)host.shards[i].rounds, (unsigned long)host.shards[i].ticks, (unsigned long)host.shards[i].steals);
+    }
+    printf("ticks/s %.0f, stolen %.1f%%\n", (double)stats.ticks / seconds, stats.ticks ? 100.0 * stats.steals / stats.ticks : 0.0);
+
+    thost_destroy(&host);
+    free(hgames);
+
+    return 0;
+}
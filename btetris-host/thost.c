@@ -0,0 +1,318 @@
+#define _GNU_SOURCE
+#include "thost.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// --- Private Functions --- //
+
+/// @brief Worker thread, runs the tick loop of one shard
+/// @param arg Shard object
+/// @return NULL
+void* thost_worker(void* arg);
+
+/// @brief Claims and ticks chunks of a shard's games until none are left this round
+/// @param self Shard of the calling worker
+/// @param shard Shard to claim games from
+/// @return Number of games ticked
+uint64_t thost_drain(thost_shard_t* self, thost_shard_t* shard);
+
+
+// --- Public Functions --- //
+
+int thost_init(thost_t* host, int nshards, int32_t capacity)
+{
+    size_t size;
+    int32_t per_shard;
+
+    if (!host) {
+        return THOST_ERROR_NULL_INARG;
+    }
+    if (nshards < 1 || nshards > THOST_MAX_SHARDS || capacity < 1) {
+        return THOST_ERROR_INVALID_INARG;
+    }
+
+    memset(host, 0, sizeof(thost_t));
+    atomic_init(&host->running, 0);
+
+    host->shards = aligned_alloc(TETRIS_CACHE_LINE, nshards * sizeof(thost_shard_t));
+    if (!host->shards)
+    {
+        thost_destroy(host);
+        return THOST_ERROR_ALLOC;
+    }
+    memset(host->shards, 0, nshards * sizeof(thost_shard_t));
+    host->nshards = nshards;
+
+    per_shard = (capacity + nshards - 1) / nshards;
+    size = tetris_pool_arena_size(per_shard);
+    for (int i = 0; i < nshards; i++)
+    {
+        thost_shard_t* shard = &host->shards[i];
+
+        atomic_init(&shard->next, 0);
+        atomic_init(&shard->active, 0);
+        atomic_init(&shard->finished, 0);
+        shard->host = host;
+        shard->idx = i;
+        shard->cap = per_shard;
+        shard->games = malloc(per_shard * sizeof(tetris_game_t*));
+        shard->users = malloc(per_shard * sizeof(void*));
+        shard->arena = malloc(size);
+        if (!shard->games || !shard->users || !shard->arena || tetris_pool_init(&shard->pool, shard->arena, size) != TETRIS_SUCCESS)
+        {
+            thost_destroy(host);
+            return THOST_ERROR_ALLOC;
+        }
+    }
+
+    return THOST_SUCCESS;
+}
+
+void thost_destroy(thost_t* host)
+{
+    if (!host) {
+        return;
+    }
+
+    thost_stop(host);
+
+    if (host->shards)
+    {
+        for (int i = 0; i < host->nshards; i++)
+        {
+            free(host->shards[i].games);
+            free(host->shards[i].users);
+            free(host->shards[i].arena);
+        }
+        free(host->shards);
+    }
+
+    host->shards = NULL;
+    host->nshards = 0;
+}
+
+tetris_game_t* thost_add(thost_t* host, int32_t seed, void* user)
+{
+    thost_shard_t* shard;
+    tetris_handle_t handle;
+
+    if (!host || !host->shards || atomic_load(&host->running)) {
+        return NULL;
+    }
+
+    shard = &host->shards[host->nadd % host->nshards];
+    if (shard->count >= shard->cap) {
+        return NULL;
+    }
+
+    handle = tetris_pool_alloc(&shard->pool, seed);
+    if (!handle) {
+        return NULL;
+    }
+
+    shard->games[shard->count] = tetris_pool_get(&shard->pool, handle);
+    shard->users[shard->count] = user;
+    shard->count++;
+    host->nadd++;
+
+    return shard->games[shard->count - 1];
+}
+
+void thost_set_step(thost_t* host, thost_step_t step)
+{
+    if (!host || atomic_load(&host->running)) {
+        return;
+    }
+
+    host->step = step;
+}
+
+int thost_start(thost_t* host, uint32_t period, int8_t paced)
+{
+    long ncpu;
+
+    if (!host || !host->shards) {
+        return THOST_ERROR_NULL_INARG;
+    }
+    if (atomic_load(&host->running)) {
+        return THOST_ERROR_RUNNING;
+    }
+
+    host->period = period;
+    host->paced = paced;
+    atomic_store(&host->running, 1);
+
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < host->nshards; i++)
+    {
+        thost_shard_t* shard = &host->shards[i];
+        pthread_attr_t attr;
+        cpu_set_t cpus;
+        int err;
+
+        // Shards stay on their own core so their games stay in that core's cache
+        pthread_attr_init(&attr);
+        if (ncpu > 0)
+        {
+            CPU_ZERO(&cpus);
+            CPU_SET(i % ncpu, &cpus);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+
+        atomic_store(&shard->next, shard->count);
+        atomic_store(&shard->finished, shard->rounds);
+        err = pthread_create(&shard->thread, &attr, thost_worker, shard);
+        pthread_attr_destroy(&attr);
+
+        if (err)
+        {
+            // Join the workers that did start
+            atomic_store(&host->running, 0);
+            for (int j = 0; j < i; j++) {
+                pthread_join(host->shards[j].thread, NULL);
+            }
+            return THOST_ERROR_THREAD;
+        }
+    }
+
+    return THOST_SUCCESS;
+}
+
+void thost_stop(thost_t* host)
+{
+    if (!host || !atomic_exchange(&host->running, 0)) {
+        return;
+    }
+
+    for (int i = 0; i < host->nshards; i++) {
+        pthread_join(host->shards[i].thread, NULL);
+    }
+}
+
+void thost_stats(const thost_t* host, thost_stats_t* stats)
+{
+    if (!host || !stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(thost_stats_t));
+    for (int i = 0; i < host->nshards; i++)
+    {
+        stats->ticks += host->shards[i].ticks;
+        stats->steals += host->shards[i].steals;
+        stats->rounds += host->shards[i].rounds;
+        stats->overruns += host->shards[i].overruns;
+    }
+}
+
+void thost_tick(void* user, tetris_game_t* game, uint64_t tmicro)
+{
+    (void)user;
+
+    if (tetris_tick(game, tmicro) == TETRIS_ERROR_GAME_OVER)
+    {
+        tetris_reset(game);
+        tetris_start(game);
+    }
+}
+
+
+// --- Private Function Definitions --- //
+
+void* thost_worker(void* arg)
+{
+    thost_shard_t* self = arg;
+    thost_t* host = self->host;
+    struct timespec deadline, now;
+    uint64_t done;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (atomic_load_explicit(&host->running, memory_order_relaxed))
+    {
+        // Sleep until the next round is due
+        if (host->paced)
+        {
+            deadline.tv_nsec += (long)host->period * 1000;
+            while (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_nsec -= 1000000000L;
+                deadline.tv_sec++;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec > deadline.tv_nsec))
+            {
+                // Behind schedule, start now instead of running rounds back to back to catch up
+                self->overruns++;
+                deadline = now;
+            }
+            else {
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+            }
+        }
+        // Back to back rounds still start together, otherwise shards drift apart in game time and never steal
+        else
+        {
+            for (int i = 0; i < host->nshards; i++)
+            {
+                while (atomic_load(&host->shards[i].finished) < self->rounds && atomic_load_explicit(&host->running, memory_order_relaxed)) {
+                    sched_yield();
+                }
+            }
+        }
+
+        // A thief might still be ticking a game claimed last round
+        while (atomic_load(&self->active)) {
+            sched_yield();
+        }
+
+        // Start the round, own games first
+        atomic_store(&self->next, 0);
+        self->rounds++;
+        self->ticks += thost_drain(self, self);
+
+        // Help shards that are still busy with their round
+        for (int i = 1; i < host->nshards; i++)
+        {
+            thost_shard_t* victim = &host->shards[(self->idx + i) % host->nshards];
+
+            if (atomic_load_explicit(&victim->next, memory_order_relaxed) >= victim->count) {
+                continue;
+            }
+
+            atomic_fetch_add(&victim->active, 1);
+            done = thost_drain(self, victim);
+            atomic_fetch_sub(&victim->active, 1);
+
+            self->ticks += done;
+            self->steals += done;
+        }
+        atomic_store(&self->finished, self->rounds);
+    }
+
+    return NULL;
+}
+
+uint64_t thost_drain(thost_shard_t* self, thost_shard_t* shard)
+{
+    thost_step_t step = self->host->step ? self->host->step : thost_tick;
+    uint32_t tmicro = self->host->period;
+    uint64_t done = 0;
+    int32_t idx, end;
+
+    while ((idx = atomic_fetch_add(&shard->next, THOST_CHUNK)) < shard->count)
+    {
+        end = (idx + THOST_CHUNK < shard->count) ? idx + THOST_CHUNK : shard->count;
+        for (int32_t i = idx; i < end; i++) {
+            step(shard->users[i], shard->games[i], tmicro);
+        }
+        done += end - idx;
+    }
+
+    return done;
+}
@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "btetris_game.h"
+#include "btetris_pool.h"
+
+#ifndef __THOST__
+#define __THOST__
+
+// Number of games claimed at once from a shard, by its own worker or a thief
+#define THOST_CHUNK 8
+
+// Maximum number of shards
+#define THOST_MAX_SHARDS 256
+
+typedef enum thost_error {
+    THOST_SUCCESS = 0,
+    THOST_ERROR_NULL_INARG = 1,
+    THOST_ERROR_INVALID_INARG = 2,
+    THOST_ERROR_ALLOC = 3,
+    THOST_ERROR_THREAD = 4,
+    THOST_ERROR_RUNNING = 5
+} thost_error_t;
+
+/// @brief Advances one game by one tick. Runs on any worker, but never on two workers for the same game at once.
+/// @param user Pointer given to `thost_add()`
+/// @param game Game object
+/// @param tmicro Microseconds since the last tick
+typedef void (*thost_step_t)(void* user, tetris_game_t* game, uint64_t tmicro);
+
+/*
+ * Games of a shard are ticked once per round. The shard's worker and idle workers of other shards
+ * claim games in chunks from `next`. A round only starts once thieves of the last round are done.
+ */
+typedef struct thost_shard
+{
+    // Shared between workers
+    _Alignas(TETRIS_CACHE_LINE) atomic_int next;    // Next unclaimed game of this round
+    atomic_int      active;                         // Number of thieves claiming from this shard
+    atomic_ulong    finished;                       // Rounds this shard's worker has finished, own games and stealing
+
+    // Only changed while the host is stopped
+    _Alignas(TETRIS_CACHE_LINE) tetris_pool_t pool;  // Games of this shard are allocated next to each other
+    void*           arena;
+    tetris_game_t** games;
+    void**          users;      // User pointer of each game
+    int32_t         count;      // Number of games
+    int32_t         cap;        // Size of games and users
+    struct thost*   host;
+    pthread_t       thread;
+    int             idx;
+
+    // Written by this shard's worker only, kept apart from the fields thieves read
+    _Alignas(TETRIS_CACHE_LINE) uint64_t ticks;     // Games ticked by this worker, including stolen ones
+    uint64_t    steals;     // Games ticked for other shards
+    uint64_t    rounds;     // Rounds started
+    uint64_t    overruns;   // Rounds that started after their deadline
+} thost_shard_t;
+
+typedef struct thost
+{
+    thost_shard_t*  shards;
+    int             nshards;
+    int32_t         nadd;       // Number of games added, next game goes to shard `nadd % nshards`
+
+    thost_step_t    step;       // NULL ticks with `thost_tick()`
+    uint32_t        period;     // Microseconds per round, given to every tick
+    int8_t          paced;      // Rounds wait for their deadline, otherwise shards run as fast as they can
+    atomic_int      running;
+} thost_t;
+
+typedef struct thost_stats
+{
+    uint64_t ticks;
+    uint64_t steals;
+    uint64_t rounds;
+    uint64_t overruns;
+} thost_stats_t;
+
+
+/// @brief Allocates shards, each with its own pool of games
+/// @param host Host object
+/// @param nshards Number of shards, one worker thread each
+/// @param capacity Maximum number of games
+/// @return Error value
+int thost_init(thost_t* host, int nshards, int32_t capacity);
+
+/// @brief Stops the host if it is running and frees its memory. Games are freed too.
+/// @param host Host object
+void thost_destroy(thost_t* host);
+
+/// @brief Adds an initialized game, shards are filled in turn. Only allowed while the host is stopped.
+/// @param host Host object
+/// @param seed Seed for the game's RNG
+/// @param user Pointer given to the step function of this game
+/// @return Game object, NULL if the host is full or running
+tetris_game_t* thost_add(thost_t* host, int32_t seed, void* user);
+
+/// @brief Sets the function that advances a game. Only allowed while the host is stopped.
+/// @param host Host object
+/// @param step Step function, NULL to use `thost_tick()`
+void thost_set_step(thost_t* host, thost_step_t step);
+
+/// @brief Starts a worker thread for every shard, pinned to a core
+/// @param host Host object
+/// @param period Microseconds per round
+/// @param paced Set to wait for each round's deadline. Otherwise rounds run back to back, each one starting once every
+/// shard has finished the last one.
+/// @return Error value
+int thost_start(thost_t* host, uint32_t period, int8_t paced);
+
+/// @brief Stops and joins the worker threads after their current round
+/// @param host Host object
+void thost_stop(thost_t* host);
+
+/// @brief Sums the counters of every shard. Only accurate while the host is stopped.
+/// @param host Host object
+/// @param stats Sum of shard counters
+void thost_stats(const thost_t* host, thost_stats_t* stats);
+
+/// @brief Default step function. Ticks the game and restarts it after a game over.
+/// @param user Unused
+/// @param game Game object
+/// @param tmicro Microseconds since the last tick
+void thost_tick(void* user, tetris_game_t* game, uint64_t tmicro);
+
+#endif
@@ -0,0 +1,114 @@
+#include "btetris_bag.h"
+#include "btetris_rng.h"
+
+// --- Function Declarations --- //
+
+/// @brief Fills an array with the shuffled contents of a bag
+/// @param seed Seed of the tetromino sequence
+/// @param bidx Index of the bag to generate
+/// @param out Array to fill
+void tetris_bag_fill(uint64_t seed, int32_t bidx, int8_t out[TETRIS_BAG_SIZE]);
+
+
+// --- Function Definitions --- //
+
+// Initializes a bag generator
+void tetris_bag_init(tetris_bag_t* bag, uint64_t seed)
+{
+    bag->seed = seed;
+
+    // Mark bag as empty so the first pop generates bag 0
+    bag->bidx = -1;
+    bag->pos = TETRIS_BAG_SIZE;
+}
+
+// Pops the next tetromino
+tetris_color_t tetris_bag_pop(tetris_bag_t* bag)
+{
+    // Generate the next bag only when it is needed
+    if (bag->pos >= TETRIS_BAG_SIZE) 
+    {
+        bag->bidx++;
+        bag->pos = 0;
+        tetris_bag_fill(bag->seed, bag->bidx, bag->bag);
+    }
+
+    return bag->bag[bag->pos++];
+}
+
+// Gets the tetromino at any index of the sequence without popping
+tetris_color_t tetris_bag_get(const tetris_bag_t* bag, int32_t n)
+{
+    int8_t tmp_bag[TETRIS_BAG_SIZE];
+    int32_t bidx;
+
+    if (n < 0) {
+        return TETRIS_BLANK;
+    }
+    bidx = n / TETRIS_BAG_SIZE;
+
+    // Use cached bag if possible
+    if (bidx == bag->bidx) {
+        return bag->bag[n % TETRIS_BAG_SIZE];
+    }
+
+    tetris_bag_fill(bag->seed, bidx, tmp_bag);
+    return tmp_bag[n % TETRIS_BAG_SIZE];
+}
+
+// Moves the bag so the next pop returns the tetromino at index n
+void tetris_bag_seek(tetris_bag_t* bag, int32_t n)
+{
+    int32_t bidx;
+
+    if (n < 0) {
+        n = 0;
+    }
+    bidx = n / TETRIS_BAG_SIZE;
+
+    // Only regenerate if the index is in a different bag
+    if (bidx != bag->bidx) 
+    {
+        bag->bidx = bidx;
+        tetris_bag_fill(bag->seed, bidx, bag->bag);
+    }
+    bag->pos = n % TETRIS_BAG_SIZE;
+}
+
+// Gets the index of the next tetromino to be popped
+int32_t tetris_bag_tell(const tetris_bag_t* bag)
+{
+    return bag->bidx * TETRIS_BAG_SIZE + bag->pos;
+}
+
+// Fills an array with the shuffled contents of a bag
+void tetris_bag_fill(uint64_t seed, int32_t bidx, int8_t out[TETRIS_BAG_SIZE])
+{
+    uint64_t key;
+    uint32_t r;
+    int color, j;
+    int8_t temp;
+
+    // Bag contents continue the I, O, J, L, S, T, Z cycle from the previous bag
+    color = ((int64_t)bidx * TETRIS_BAG_SIZE) % 7;
+    for (int i = 0; i < TETRIS_BAG_SIZE; i++)
+    {
+        out[i] = (int8_t)(color + 1);
+        color = (color == 6) ? 0 : color + 1;
+    }
+
+    // Bag key only depends on the seed and bag index, any bag can be generated directly
+    key = tetris_rng_mix64(seed + (uint64_t)bidx);
+
+    // Fisher-Yates shuffle
+    for (int i = TETRIS_BAG_SIZE - 1; i > 0; i--)
+    {
+        // Map random number to [0, i] without division
+        r = (uint32_t)(tetris_rng_mix64(key + i) >> 32);
+        j = (int)(((uint64_t)r * (uint32_t)(i + 1)) >> 32);
+
+        temp = out[i];
+        out[i] = out[j];
+        out[j] = temp;
+    }
+}
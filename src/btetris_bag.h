@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include "btetris_board.h"
+
+#ifndef __TETRIS_BAG__
+#define __TETRIS_BAG__
+
+// Number of tetrominoes in a bag. Bags of a multiple of 7 contain every tetromino equally. 
+// Other sizes cycle through the tetrominoes across bags.
+#ifndef TETRIS_BAG_SIZE
+    #define TETRIS_BAG_SIZE 7
+#elif TETRIS_BAG_SIZE < 1
+    #error invalid bag size, too small
+#elif TETRIS_BAG_SIZE > 63
+    #error invalid bag size, too large
+#endif
+
+
+// --- Bag Structures --- //
+
+typedef struct tetris_bag 
+{
+    uint64_t        seed;                   // Every bag is generated from this seed and its bag index
+    int32_t         bidx;                   // Index of the bag stored in `bag`
+    int8_t          pos;                    // Position of the next tetromino in `bag`
+    int8_t          bag[TETRIS_BAG_SIZE];   // Shuffled tetrominoes of the current bag, tetris_color_t
+} tetris_bag_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Initializes a bag generator. First bag is generated on the first pop.
+/// @param bag Bag object
+/// @param seed Seed for the whole tetromino sequence
+void tetris_bag_init(tetris_bag_t* bag, uint64_t seed);
+
+/// @brief Pops the next tetromino, generates a new bag when the current one is empty
+/// @param bag Bag object
+/// @return Popped tetromino
+tetris_color_t tetris_bag_pop(tetris_bag_t* bag);
+
+/// @brief Gets the tetromino at any index of the sequence without popping
+/// @param bag Bag object
+/// @param n Index in the sequence, first tetromino after init is 0
+/// @return Tetromino at index n, TETRIS_BLANK if n is negative
+tetris_color_t tetris_bag_get(const tetris_bag_t* bag, int32_t n);
+
+/// @brief Moves the bag so the next pop returns the tetromino at index n
+/// @param bag Bag object
+/// @param n Index in the sequence, negative values seek to 0
+void tetris_bag_seek(tetris_bag_t* bag, int32_t n);
+
+/// @brief Gets the index of the next tetromino to be popped
+/// @param bag Bag object
+/// @return Sequence index
+int32_t tetris_bag_tell(const tetris_bag_t* bag);
+
+#endif
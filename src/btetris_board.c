@@ -1,5 +1,104 @@
+#include <string.h>
 #include "btetris_board.h"
 
+// --- Function Definitions --- //
+
+// Initializes an empty board
+void tetris_board_init(tetris_board_t* board)
+{
+    // Surround the playfield with sentinel cells
+    for (int h = 0; h < TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF+2*TETRIS_PF_PAD; h++)
+    {
+        for (int w = 0; w < TETRIS_WIDTH+2*TETRIS_PF_PAD; w++) 
+        {
+            board->pf[h][w] = TETRIS_WALL;
+        }
+    }
+
+    for (int h = 0; h < TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF; h++)
+    {
+        for (int w = 0; w < TETRIS_WIDTH; w++) 
+        {
+            TETRIS_PF(board, h, w) = TETRIS_BLANK;
+        }
+        board->rowcnt[h] = 0;
+    }
+    board->pf_height = 0;
+    board->cellcnt = 0;
+
+    board->fpos[0] = (tetris_coord_t){-1, -1};
+    board->fpos[1] = (tetris_coord_t){-1, -1};
+    board->fpos[2] = (tetris_coord_t){-1, -1};
+    board->fpos[3] = (tetris_coord_t){-1, -1};
+
+    board->frot = 0;
+    board->fkick = -1;
+    board->fcol = TETRIS_BLANK;
+
+    board->gc_valid = 0;
+    board->gc_pos[0] = (tetris_coord_t){-1, -1};
+    board->gc_pos[1] = (tetris_coord_t){-1, -1};
+    board->gc_pos[2] = (tetris_coord_t){-1, -1};
+    board->gc_pos[3] = (tetris_coord_t){-1, -1};
+}
+
+// Pushes the playfield up and fills the bottom rows with garbage
+int8_t tetris_board_garbage(tetris_board_t* board, int8_t lines, int8_t hole)
+{
+    const int top = TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF;
+    int8_t over = 0;
+    int move, filled;
+
+    if (lines <= 0) {
+        return 0;
+    }
+    if (lines > top) {
+        lines = top;
+    }
+
+    // Rows pushed out of the top are lost
+    for (int h = top - lines; h < top; h++)
+    {
+        if (board->rowcnt[h])
+        {
+            board->cellcnt -= board->rowcnt[h];
+            over = 1;
+        }
+    }
+
+    // Highest filled row, -1 if the playfield is empty. pf_height is 0 both for an empty playfield and for one
+    // with only its bottom row filled, so it can't tell them apart.
+    filled = board->pf_height;
+    while (filled >= 0 && !board->rowcnt[filled]) {
+        filled--;
+    }
+
+    // Rows are contiguous in memory and sentinel columns are the same in every row, move them as one block
+    move = (board->pf_height + 1 < top - lines) ? board->pf_height + 1 : top - lines;
+    if (move > 0)
+    {
+        memmove(board->pf[lines+TETRIS_PF_PAD], board->pf[TETRIS_PF_PAD], move * sizeof(board->pf[0]));
+        memmove(&board->rowcnt[lines], &board->rowcnt[0], move * sizeof(board->rowcnt[0]));
+    }
+
+    // Build the first garbage row, then copy it into the others
+    for (int w = 0; w < TETRIS_WIDTH; w++) {
+        TETRIS_PF(board, 0, w) = (w == hole) ? TETRIS_BLANK : TETRIS_GARBAGE;
+    }
+    board->rowcnt[0] = (hole >= 0 && hole < TETRIS_WIDTH) ? TETRIS_WIDTH-1 : TETRIS_WIDTH;
+    for (int h = 1; h < lines; h++)
+    {
+        memcpy(&TETRIS_PF(board, h, 0), &TETRIS_PF(board, 0, 0), TETRIS_WIDTH*sizeof(tetris_color_t));
+        board->rowcnt[h] = board->rowcnt[0];
+    }
+
+    board->cellcnt += lines * board->rowcnt[0];
+    board->pf_height = (filled + lines < top) ? filled + lines : top - 1;
+    board->gc_valid = 0;
+
+    return over;
+}
+
 const tetris_coord_t TETRIS_TETROMINO_START[8][4] = {
     {   // Blank
         {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1},
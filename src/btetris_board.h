@@ -6,12 +6,15 @@
 // Additional row buffer at top of the board
 #define TETRIS_HEIGHT_BUFF 4    
 
+// Sentinel cells around each side of the playfield, covers every position a movement or kick test can reach
+#define TETRIS_PF_PAD 3
+
 // Width of tetris board
 #ifndef  TETRIS_WIDTH
     #define TETRIS_WIDTH 10         
 #elif TETRIS_WIDTH < 4
     #error invalid width, too small
-#elif TETRIS_WIDTH > 127
+#elif TETRIS_WIDTH > 127-TETRIS_PF_PAD
     #error invalid width, too large
 #endif
 
@@ -35,7 +38,9 @@ typedef enum tetris_color {
     TETRIS_ORANGE   = 4,
     TETRIS_GREEN    = 5,
     TETRIS_PURPLE   = 6,
-    TETRIS_RED      = 7
+    TETRIS_RED      = 7,
+    TETRIS_WALL     = 8,    // Sentinel cells around the playfield
+    TETRIS_GARBAGE  = 9     // Garbage rows received in versus mode
 } tetris_color_t;
 
 typedef struct tetris_coord {
@@ -45,24 +50,42 @@ typedef struct tetris_coord {
 
 typedef struct tetris_board
 {
-    // playfield, contains only locked tetrominos
-    tetris_color_t pf[TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF][TETRIS_WIDTH];
-    int8_t pf_height;   // Index of highest row in playfield
-
-    // Falling tetromino info
+    // Falling tetromino info, kept in front of the playfield so it shares a cache line with the board's counters
     tetris_coord_t  fpos[4];    // Position of tetromino's squares
     tetris_color_t  fcol;       // Tetromino color
     int8_t          frot;       // Current rotation of tetromino
+    int8_t          fkick;      // Kick test used by last movement if it was a rotation, -1 otherwise
 
     // Ghost piece cache
     int8_t          gc_valid;   // True when ghost piece cache is valid
     tetris_coord_t  gc_pos[4];  // Ghost piece position data
- 
+
+    // playfield, contains only locked tetrominos. Surrounded by sentinel cells, index with `TETRIS_PF()`
+    int8_t pf_height;   // Index of highest row in playfield
+    int16_t cellcnt;    // Number of filled cells in playfield
+    int8_t rowcnt[TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF];    // Number of filled cells in each row
+    tetris_color_t pf[TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF+2*TETRIS_PF_PAD][TETRIS_WIDTH+2*TETRIS_PF_PAD];
+
 } tetris_board_t;
 
+// Playfield cell at height h and width w, positions up to TETRIS_PF_PAD outside of the playfield are TETRIS_WALL
+#define TETRIS_PF(board, h, w) ((board)->pf[(h)+TETRIS_PF_PAD][(w)+TETRIS_PF_PAD])
+
 
 // --- Function Declarations --- //
 
+/// @brief Initializes an empty board without a falling tetromino
+/// @param board Board object
+void tetris_board_init(tetris_board_t* board);
+
+/// @brief Pushes the playfield up and fills the bottom rows with garbage. Rows are moved in one block, not cell by cell.
+/// Call while there is no falling tetromino, its position isn't moved.
+/// @param board Board object
+/// @param lines Number of garbage rows
+/// @param hole Column left empty in every garbage row
+/// @return 1 if filled rows were pushed out of the top of the playfield, 0 otherwise
+int8_t tetris_board_garbage(tetris_board_t* board, int8_t lines, int8_t hole);
+
 /// @brief Adds two coordinate structures
 /// @param left operand 1
 /// @param right operand 2
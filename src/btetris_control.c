@@ -1,5 +1,6 @@
 #include "btetris_control.h"
 #include "btetris_board.h"
+#include "btetris_journal.h"
 
 
 // https://tetris.fandom.com/wiki/SR
@@ -7,19 +8,6 @@
 // Used to keep rotation in the range of [0,3]
 #define MOD4(val) ((val) & 0b0011)
 
-// --- Function Declarations --- //
-
-/// @brief Checks if a given tetromino has any collisions with the playfield
-/// @param board Board object 
-/// @param tetromino Tetromino to check collisions with board playfield
-/// @return returns 1 if a collision was NOT found, returns 0 if a collision was found. 
-int8_t tetris_collisionCheck(tetris_board_t* board, tetris_coord_t tetromino[4]);
-
-/// @brief Places the falling tetromino into the playfield.
-/// @param board Board object
-void tetris_lockTetromino(tetris_board_t* board);
-
-
 // --- Function Definitions --- //
 
 // Rotates the falling tetromino clockwise
@@ -60,36 +48,30 @@ tetris_error_t tetris_rotcw(tetris_game_t* game)
         return TETRIS_SUCCESS;
     }
 
-    // Copy tetromino
+    // Rotate a copy using wall kicks, falling tetromino is only moved if a kick test passes
     tetris_coord_t tmpT[4];
     tmpT[0] = board->fpos[0];
     tmpT[1] = board->fpos[1];
     tmpT[2] = board->fpos[2];
     tmpT[3] = board->fpos[3];
 
-    // Check if rotation is possible in current position
-    int8_t rotPossible;
-    for (int i = 0; i < 4; i++) {   // Apply transformation
-        tmpT[i] = tetris_addCoord(tmpT[i], TETRIS_TETROMINO_ROTATE[board->fcol][board->frot][i]);
+    int8_t kick, rot = board->frot;
+    kick = tetris_rotateTetromino(board, tmpT, board->fcol, &rot, 1);
+    if (kick < 0) {
+        return TETRIS_ERROR_COLLISION;
     }
 
-    // Check if there is room for rotation
-    rotPossible = tetris_collisionCheck(board, tmpT);
-
-    // Apply transformation if there are no collisions
-    if (rotPossible) 
+    if (game->journal) 
     {
-        board->frot = MOD4(board->frot+1);
-
-        board->fpos[0] = tmpT[0];
-        board->fpos[1] = tmpT[1];
-        board->fpos[2] = tmpT[2];
-        board->fpos[3] = tmpT[3];
-    }
-    // Indicate that operation is not possible due to a colision
-    else {
-        return TETRIS_ERROR_COLLISION;
+        tetris_journal_begin(game);
+        tetris_journal_piece(game);
     }
+    board->fpos[0] = tmpT[0];
+    board->fpos[1] = tmpT[1];
+    board->fpos[2] = tmpT[2];
+    board->fpos[3] = tmpT[3];
+    board->frot = rot;
+    board->fkick = kick;
 
     // Invalidate ghost piece cache
     board->gc_valid = 0;
@@ -135,36 +117,30 @@ tetris_error_t tetris_rotcntrcw(tetris_game_t* game)
         return TETRIS_SUCCESS;
     }
 
-    // Copy tetromino
+    // Rotate a copy using wall kicks, falling tetromino is only moved if a kick test passes
     tetris_coord_t tmpT[4];
     tmpT[0] = board->fpos[0];
     tmpT[1] = board->fpos[1];
     tmpT[2] = board->fpos[2];
     tmpT[3] = board->fpos[3];
 
-    // Check if rotation is possible in current position
-    int8_t rotPossible;
-    for (int i = 0; i < 4; i++) {   // Apply transformation
-        tmpT[i] = tetris_subCoord(tmpT[i], TETRIS_TETROMINO_ROTATE[board->fcol][MOD4(board->frot-1)][i]);
+    int8_t kick, rot = board->frot;
+    kick = tetris_rotateTetromino(board, tmpT, board->fcol, &rot, -1);
+    if (kick < 0) {
+        return TETRIS_ERROR_COLLISION;
     }
 
-    // Check if there is room for rotation
-    rotPossible = tetris_collisionCheck(board, tmpT);
-
-    // Apply transformation if there are no collisions
-    if (rotPossible) 
+    if (game->journal) 
     {
-        board->frot = MOD4(board->frot-1);    // Update rotation
-
-        board->fpos[0] = tmpT[0];
-        board->fpos[1] = tmpT[1];
-        board->fpos[2] = tmpT[2];
-        board->fpos[3] = tmpT[3];
-    }
-    // Indicate that operation is not possible due to a colision
-    else {
-        return TETRIS_ERROR_COLLISION;
+        tetris_journal_begin(game);
+        tetris_journal_piece(game);
     }
+    board->fpos[0] = tmpT[0];
+    board->fpos[1] = tmpT[1];
+    board->fpos[2] = tmpT[2];
+    board->fpos[3] = tmpT[3];
+    board->frot = rot;
+    board->fkick = kick;
 
     // Invalidate ghost piece cache
     board->gc_valid = 0;
@@ -224,10 +200,16 @@ tetris_error_t tetris_leftshift(tetris_game_t* game)
     // Apply shift if there are no collisions
     if (shiftPossible) 
     {
+        if (game->journal) 
+        {
+            tetris_journal_begin(game);
+            tetris_journal_piece(game);
+        }
         board->fpos[0] = tmpT[0];
         board->fpos[1] = tmpT[1];
         board->fpos[2] = tmpT[2];
         board->fpos[3] = tmpT[3];
+        board->fkick = -1;
     }
     // Indicate that operation is not possible due to a colision
     else {
@@ -292,10 +274,16 @@ tetris_error_t tetris_rightshift(tetris_game_t* game)
     // Apply shift if there are no collisions
     if (shiftPossible) 
     {
+        if (game->journal) 
+        {
+            tetris_journal_begin(game);
+            tetris_journal_piece(game);
+        }
         board->fpos[0] = tmpT[0];
         board->fpos[1] = tmpT[1];
         board->fpos[2] = tmpT[2];
         board->fpos[3] = tmpT[3];
+        board->fkick = -1;
     }
     // Indicate that operation is not possible due to a colision
     else {
@@ -358,6 +346,12 @@ tetris_error_t tetris_sdrop(tetris_game_t* game)
     // Check if soft drop is possible
     dropPossible = tetris_collisionCheck(board, tmpT);
     
+    if (game->journal) 
+    {
+        tetris_journal_begin(game);
+        tetris_journal_piece(game);
+    }
+
     // Apply drop if there are no collisions
     if (dropPossible) 
     { 
@@ -365,9 +359,14 @@ tetris_error_t tetris_sdrop(tetris_game_t* game)
         board->fpos[1] = tmpT[1];
         board->fpos[2] = tmpT[2];
         board->fpos[3] = tmpT[3];
+        board->fkick = -1;
     }
     // Indicate that operation is not possible due to a colision
-    else {
+    else 
+    {
+        if (game->journal) {
+            tetris_journal_lock(game);
+        }
         tetris_lockTetromino(board);
         return TETRIS_ERROR_COLLISION;
     }
@@ -408,6 +407,17 @@ tetris_error_t tetris_hdrop(tetris_game_t* game)
     tetris_board_t* board;
     board = game->board;
 
+    if (game->journal) 
+    {
+        tetris_journal_begin(game);
+        tetris_journal_piece(game);
+    }
+
+    // Dropping any distance means the last movement is no longer a rotation
+    if (board->fpos[0].h != board->gc_pos[0].h) {
+        board->fkick = -1;
+    }
+
     // Set falling tetromino position to ghost piece position
     board->fpos[0] = board->gc_pos[0];
     board->fpos[1] = board->gc_pos[1];
@@ -415,11 +425,272 @@ tetris_error_t tetris_hdrop(tetris_game_t* game)
     board->fpos[3] = board->gc_pos[3];
 
     // Lock tetromino
+    if (game->journal) {
+        tetris_journal_lock(game);
+    }
     tetris_lockTetromino(board);
 
     return TETRIS_SUCCESS;
 }
 
+// Handles a key press
+tetris_error_t tetris_keydown(tetris_game_t* game, tetris_cmd_t cmd)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+
+    switch (cmd)
+    {
+    case TETRIS_CMD_LEFT:
+        // Last pressed shift key is the active one, restart auto shift delay
+        game->sheld |= 0b01;
+        game->sdir = -1;
+        game->stmr = game->das;
+        return tetris_leftshift(game);
+
+    case TETRIS_CMD_RIGHT:
+        game->sheld |= 0b10;
+        game->sdir = 1;
+        game->stmr = game->das;
+        return tetris_rightshift(game);
+
+    case TETRIS_CMD_ROTCW:
+        return tetris_rotcw(game);
+
+    case TETRIS_CMD_ROTCCW:
+        return tetris_rotcntrcw(game);
+
+    case TETRIS_CMD_SDROP:
+        return tetris_sdrop(game);
+
+    case TETRIS_CMD_HDROP:
+        return tetris_hdrop(game);
+
+    default:
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+}
+
+// Handles a key release
+tetris_error_t tetris_keyup(tetris_game_t* game, tetris_cmd_t cmd)
+{
+    int8_t dir;
+
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+
+    // Only shift keys are held
+    if (cmd == TETRIS_CMD_LEFT) 
+    {
+        game->sheld &= ~0b01;
+        dir = -1;
+    }
+    else if (cmd == TETRIS_CMD_RIGHT) 
+    {
+        game->sheld &= ~0b10;
+        dir = 1;
+    }
+    else {
+        return TETRIS_SUCCESS;
+    }
+
+    // Released key was the active one, fall back to the other shift key if it is still held
+    if (game->sdir == dir)
+    {
+        if (game->sheld) 
+        {
+            game->sdir = -dir;
+            game->stmr = game->das;
+        }
+        else {
+            game->sdir = 0;
+        }
+    }
+
+    return TETRIS_SUCCESS;
+}
+
+// Applies a sequence of inputs to the falling tetromino
+tetris_error_t tetris_apply_inputs(tetris_game_t* game, const tetris_cmd_t* cmds, int n, tetris_error_t* results)
+{
+    tetris_board_t* board;
+    tetris_error_t result;
+
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    board = game->board;
+    if (!board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+    if (!cmds && n > 0) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (board->fcol == TETRIS_BLANK) {
+        return TETRIS_ERROR_INACTIVE_TETROMINO;
+    }
+
+    // Use user input to add entropy, once for the whole sequence
+    tetris_rand_entropy(game, n);
+
+    // Dont worry about handling game logic if the game isn't running. 
+    if (game->isGameover)
+    {
+        return TETRIS_ERROR_GAME_OVER;
+    }
+    if (!game->isStarted)
+    {
+        return TETRIS_ERROR_NOT_STARTED;
+    }
+    if (!game->isRunning) {
+        return TETRIS_ERROR_GAME_PAUSED;
+    }
+
+    // Working copy of the falling tetromino
+    tetris_coord_t tmpT[4];
+    tmpT[0] = board->fpos[0];
+    tmpT[1] = board->fpos[1];
+    tmpT[2] = board->fpos[2];
+    tmpT[3] = board->fpos[3];
+    int8_t tmpRot = board->frot;
+    int8_t tmpKick = board->fkick;
+
+    int8_t moved = 0;       // True if the tetromino moved sideways or rotated, invalidates ghost cache
+    int8_t locked = 0;      // True once a command locks the tetromino
+    int8_t dw, dist, kick;
+
+    for (int c = 0; c < n; c++)
+    {
+        if (locked) 
+        {
+            if (results) {
+                results[c] = TETRIS_ERROR_INACTIVE_TETROMINO;
+            }
+            continue;
+        }
+
+        result = TETRIS_SUCCESS;
+        switch (cmds[c])
+        {
+        case TETRIS_CMD_LEFT:
+        case TETRIS_CMD_RIGHT:
+            dw = (cmds[c] == TETRIS_CMD_LEFT) ? -1 : 1;
+            tmpT[0].w += dw;
+            tmpT[1].w += dw;
+            tmpT[2].w += dw;
+            tmpT[3].w += dw;
+
+            // Undo shift if there is a collision
+            if (!tetris_collisionCheck(board, tmpT)) 
+            {
+                tmpT[0].w -= dw;
+                tmpT[1].w -= dw;
+                tmpT[2].w -= dw;
+                tmpT[3].w -= dw;
+                result = TETRIS_ERROR_COLLISION;
+            }
+            else 
+            {
+                tmpKick = -1;
+                moved = 1;
+            }
+            break;
+
+        case TETRIS_CMD_ROTCW:
+        case TETRIS_CMD_ROTCCW:
+            // Rotation doesn't have an effect on the 'O' (yellow) tetromino
+            if (board->fcol == TETRIS_YELLOW) {
+                break;
+            }
+
+            kick = tetris_rotateTetromino(board, tmpT, board->fcol, &tmpRot, (cmds[c] == TETRIS_CMD_ROTCW) ? 1 : -1);
+            if (kick < 0) {
+                result = TETRIS_ERROR_COLLISION;
+            }
+            else 
+            {
+                tmpKick = kick;
+                moved = 1;
+            }
+            break;
+
+        case TETRIS_CMD_SDROP:
+            tmpT[0].h -= 1;
+            tmpT[1].h -= 1;
+            tmpT[2].h -= 1;
+            tmpT[3].h -= 1;
+
+            // Soft drop with a collision locks the tetromino
+            if (!tetris_collisionCheck(board, tmpT)) 
+            {
+                tmpT[0].h += 1;
+                tmpT[1].h += 1;
+                tmpT[2].h += 1;
+                tmpT[3].h += 1;
+                result = TETRIS_ERROR_COLLISION;
+                locked = 1;
+            }
+            else {
+                tmpKick = -1;
+            }
+            break;
+
+        case TETRIS_CMD_HDROP:
+            dist = tetris_dropDistance(board, tmpT);
+            if (dist > 0) 
+            {
+                tmpT[0].h -= dist;
+                tmpT[1].h -= dist;
+                tmpT[2].h -= dist;
+                tmpT[3].h -= dist;
+                tmpKick = -1;
+            }
+            locked = 1;
+            break;
+
+        default:
+            result = TETRIS_ERROR_INVALID_INPUT;
+            break;
+        }
+
+        if (results) {
+            results[c] = result;
+        }
+    }
+
+    if (game->journal) 
+    {
+        tetris_journal_begin(game);
+        tetris_journal_piece(game);
+    }
+
+    // Commit working copy to the falling tetromino
+    board->fpos[0] = tmpT[0];
+    board->fpos[1] = tmpT[1];
+    board->fpos[2] = tmpT[2];
+    board->fpos[3] = tmpT[3];
+    board->frot = tmpRot;
+    board->fkick = tmpKick;
+
+    if (moved) {
+        board->gc_valid = 0;
+    }
+    if (locked) 
+    {
+        if (game->journal) {
+            tetris_journal_lock(game);
+        }
+        tetris_lockTetromino(board);
+    }
+
+    return TETRIS_SUCCESS;
+}
+
 // Calculates the position of the falling tetromino if it were to be hard dropped. 
 tetris_error_t tetris_calcGhostCoords(tetris_game_t* game)
 {
@@ -487,30 +758,118 @@ tetris_error_t tetris_calcGhostCoords(tetris_game_t* game)
 // Checks if a given tetromino has any collisions with the playfield
 int8_t tetris_collisionCheck(tetris_board_t* board, tetris_coord_t tetromino[4]) 
 {
-    // NOTE: Checked in reverse because coord array is sorted from highest to lowest. Lower blocks are more likely to have a colision. 
+    // Walls, floor and ceiling are sentinel cells, so bounds don't need to be checked. 
+    // Cells are combined instead of checked one at a time to avoid branches. 
+    return (TETRIS_PF(board, tetromino[0].h, tetromino[0].w) |
+            TETRIS_PF(board, tetromino[1].h, tetromino[1].w) |
+            TETRIS_PF(board, tetromino[2].h, tetromino[2].w) |
+            TETRIS_PF(board, tetromino[3].h, tetromino[3].w)) == TETRIS_BLANK;
+}
+
+// Counts how many rows a tetromino can drop before it collides
+int8_t tetris_dropDistance(tetris_board_t* board, const tetris_coord_t tetromino[4])
+{
+    tetris_coord_t tmpT[4];
+    int8_t dist = 0;
 
-    // Check collisions with locked/fallen tetrominos
-    for (int i = 3; i >= 0; i--) 
+    tmpT[0] = tetromino[0];
+    tmpT[1] = tetromino[1];
+    tmpT[2] = tetromino[2];
+    tmpT[3] = tetromino[3];
+
+    // Drop tetromino until it collides
+    do 
     {
-        if (board->pf[tetromino[i].h][tetromino[i].w] != TETRIS_BLANK) {
-            return 0;
+        tmpT[0].h--;
+        tmpT[1].h--;
+        tmpT[2].h--;
+        tmpT[3].h--;
+        dist++;
+    }
+    while (tetris_collisionCheck(board, tmpT));
+
+    // Last drop had a collision
+    return dist - 1;
+}
+
+// Counts how many columns a tetromino can shift before it collides
+int8_t tetris_shiftDistance(tetris_board_t* board, const tetris_coord_t tetromino[4], int8_t dir)
+{
+    int8_t dist, w;
+    int8_t min_dist = TETRIS_WIDTH;
+
+    // Scan each block's row towards the wall, closest filled cell or wall limits the shift
+    for (int i = 0; i < 4; i++)
+    {
+        dist = 0;
+        w = tetromino[i].w + dir;
+        while (TETRIS_PF(board, tetromino[i].h, w) == TETRIS_BLANK && dist < min_dist) 
+        {
+            w += dir;
+            dist++;
         }
+
+        if (dist < min_dist) {
+            min_dist = dist;
+        }
+    }
+
+    return min_dist;
+}
+
+// Rotates a tetromino using the SRS wall kick tests
+int8_t tetris_rotateTetromino(tetris_board_t* board, tetris_coord_t tetromino[4], tetris_color_t color, int8_t* rot, int8_t dir)
+{
+    tetris_coord_t rotT[4];         // Rotated tetromino without a kick
+    tetris_coord_t kickT[4];        // Rotated tetromino with current kick applied
+    const tetris_coord_t* kicks;    // Kick tests for this rotation
+    int8_t newRot;
+
+    // Rotation doesn't have an effect on the 'O' (yellow) tetromino
+    if (color == TETRIS_YELLOW) {
+        return 0;
     }
 
-    // Check border bounds collisions before checking playfield array
-    for (int i = 3; i >= 0; i--) 
+    // Apply rotation transformation once, kick tests only translate it
+    if (dir > 0) 
     {
-        if (tetromino[i].h < 0 || tetromino[i].h >= TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF) {
-            return 0;
+        newRot = MOD4(*rot+1);
+        for (int i = 0; i < 4; i++) {
+            rotT[i] = tetris_addCoord(tetromino[i], TETRIS_TETROMINO_ROTATE[color][*rot][i]);
         }
+        kicks = TETRIS_SRS_KICKS[color == TETRIS_CYAN][*rot][0];
+    }
+    else 
+    {
+        newRot = MOD4(*rot-1);
+        for (int i = 0; i < 4; i++) {
+            rotT[i] = tetris_subCoord(tetromino[i], TETRIS_TETROMINO_ROTATE[color][newRot][i]);
+        }
+        kicks = TETRIS_SRS_KICKS[color == TETRIS_CYAN][*rot][1];
+    }
 
-        if (tetromino[i].w < 0 || tetromino[i].w >= TETRIS_WIDTH) {
-            return 0;
+    // Use the first kick test without a collision
+    for (int k = 0; k < 5; k++)
+    {
+        kickT[0] = tetris_addCoord(rotT[0], kicks[k]);
+        kickT[1] = tetris_addCoord(rotT[1], kicks[k]);
+        kickT[2] = tetris_addCoord(rotT[2], kicks[k]);
+        kickT[3] = tetris_addCoord(rotT[3], kicks[k]);
+
+        if (tetris_collisionCheck(board, kickT)) 
+        {
+            tetromino[0] = kickT[0];
+            tetromino[1] = kickT[1];
+            tetromino[2] = kickT[2];
+            tetromino[3] = kickT[3];
+            *rot = newRot;
+
+            return k;
         }
     }
 
-    // All checks passed, return 1 to declare no collisions
-    return 1;
+    // Every kick test had a collision
+    return -1;
 }
 
 // Places the falling tetromino into the playfield. 
@@ -518,8 +877,10 @@ void tetris_lockTetromino(tetris_board_t* board)
 {
     // Lock the tetromino
     for (int i = 0; i < 4; i++) {
-        board->pf[board->fpos[i].h][board->fpos[i].w] = board->fcol;
+        TETRIS_PF(board, board->fpos[i].h, board->fpos[i].w) = board->fcol;
+        board->rowcnt[board->fpos[i].h]++;
     }
+    board->cellcnt += 4;
 
     // Clear tetromino color to indicate that it is no longer active
     board->fcol = TETRIS_BLANK;
@@ -584,4 +945,28 @@ const tetris_coord_t TETRIS_TETROMINO_ROTATE[8][4][4] = {
     {{-1, -2}, {0, 0}, {-1, -1}, {0, 1}},
     {{1, 1}, {0, -1}, {1, 0}, {0, -2}},
     {{0, -1}, {1, 1}, {0, 0}, {1, 2}}}
+};
+
+// {h, w} offsets, see https://tetris.wiki/Super_Rotation_System#Wall_Kicks
+const tetris_coord_t TETRIS_SRS_KICKS[2][4][2][5] = {
+
+    // J, L, S, T, Z
+    {{{{0, 0}, {0, -1}, {1, -1}, {-2, 0}, {-2, -1}},    // 0 -> R
+      {{0, 0}, {0, 1}, {1, 1}, {-2, 0}, {-2, 1}}},      // 0 -> L
+     {{{0, 0}, {0, 1}, {-1, 1}, {2, 0}, {2, 1}},        // R -> 2
+      {{0, 0}, {0, 1}, {-1, 1}, {2, 0}, {2, 1}}},       // R -> 0
+     {{{0, 0}, {0, 1}, {1, 1}, {-2, 0}, {-2, 1}},       // 2 -> L
+      {{0, 0}, {0, -1}, {1, -1}, {-2, 0}, {-2, -1}}},   // 2 -> R
+     {{{0, 0}, {0, -1}, {-1, -1}, {2, 0}, {2, -1}},     // L -> 0
+      {{0, 0}, {0, -1}, {-1, -1}, {2, 0}, {2, -1}}}},   // L -> 2
+
+    // I
+    {{{{0, 0}, {0, -2}, {0, 1}, {-1, -2}, {2, 1}},      // 0 -> R
+      {{0, 0}, {0, -1}, {0, 2}, {2, -1}, {-1, 2}}},     // 0 -> L
+     {{{0, 0}, {0, -1}, {0, 2}, {2, -1}, {-1, 2}},      // R -> 2
+      {{0, 0}, {0, 2}, {0, -1}, {1, 2}, {-2, -1}}},     // R -> 0
+     {{{0, 0}, {0, 2}, {0, -1}, {1, 2}, {-2, -1}},      // 2 -> L
+      {{0, 0}, {0, 1}, {0, -2}, {-2, 1}, {1, -2}}},     // 2 -> R
+     {{{0, 0}, {0, 1}, {0, -2}, {-2, 1}, {1, -2}},      // L -> 0
+      {{0, 0}, {0, -2}, {0, 1}, {-1, -2}, {2, 1}}}}     // L -> 2
 };
\ No newline at end of file
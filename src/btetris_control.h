@@ -6,6 +6,19 @@
 #define __TETRIS_CONTROL__
 
 
+// --- Control Structures --- //
+
+// Input commands for `tetris_apply_inputs()`
+typedef enum tetris_cmd {
+    TETRIS_CMD_LEFT = 0,
+    TETRIS_CMD_RIGHT,
+    TETRIS_CMD_ROTCW,
+    TETRIS_CMD_ROTCCW,
+    TETRIS_CMD_SDROP,
+    TETRIS_CMD_HDROP
+} tetris_cmd_t;
+
+
 // --- Function Declarations --- //
 
 /// @brief Rotates the falling tetromino clockwise
@@ -38,12 +51,71 @@ tetris_error_t tetris_sdrop(tetris_game_t* game);
 /// @return Error code
 tetris_error_t tetris_hdrop(tetris_game_t* game);
 
+/// @brief Handles a key press. Shift keys start auto shift, which `tetris_tick()` repeats while the key is held. 
+/// Other commands are applied once.
+/// @param game Game object
+/// @param cmd Command bound to the pressed key
+/// @return Error code of the applied command
+tetris_error_t tetris_keydown(tetris_game_t* game, tetris_cmd_t cmd);
+
+/// @brief Handles a key release. Stops auto shift if the released key was the active shift key. 
+/// @param game Game object
+/// @param cmd Command bound to the released key
+/// @return Error code
+tetris_error_t tetris_keyup(tetris_game_t* game, tetris_cmd_t cmd);
+
+/// @brief Applies a sequence of inputs to the falling tetromino. Game state is only checked once. 
+/// Commands after one that locks the tetromino result in TETRIS_ERROR_INACTIVE_TETROMINO. 
+/// @param game Game object
+/// @param cmds Array of commands
+/// @param n Number of commands
+/// @param results Result of each command, same codes as the single input functions. Can be NULL. 
+/// @return Error code of game state checks, results aren't written if this isn't TETRIS_SUCCESS
+tetris_error_t tetris_apply_inputs(tetris_game_t* game, const tetris_cmd_t* cmds, int n, tetris_error_t* results);
+
 /// @brief Calculates the position of the falling tetromino if it were to be hard dropped. 
 /// @param game Game object
 /// @return Error code
 tetris_error_t tetris_calcGhostCoords(tetris_game_t* game);
 
 
+// --- Board Functions --- //
+
+// These functions work on the board directly and skip game state checks and entropy. 
+
+/// @brief Checks if a given tetromino has any collisions with the playfield
+/// @param board Board object 
+/// @param tetromino Tetromino to check collisions with board playfield
+/// @return returns 1 if a collision was NOT found, returns 0 if a collision was found. 
+int8_t tetris_collisionCheck(tetris_board_t* board, tetris_coord_t tetromino[4]);
+
+/// @brief Places the falling tetromino into the playfield.
+/// @param board Board object
+void tetris_lockTetromino(tetris_board_t* board);
+
+/// @brief Counts how many rows a tetromino can drop before it collides
+/// @param board Board object
+/// @param tetromino Tetromino to drop
+/// @return Number of rows
+int8_t tetris_dropDistance(tetris_board_t* board, const tetris_coord_t tetromino[4]);
+
+/// @brief Counts how many columns a tetromino can shift before it collides with the wall or stack
+/// @param board Board object
+/// @param tetromino Tetromino to shift
+/// @param dir -1 for left, 1 for right
+/// @return Number of columns
+int8_t tetris_shiftDistance(tetris_board_t* board, const tetris_coord_t tetromino[4], int8_t dir);
+
+/// @brief Rotates a tetromino using the SRS wall kick tests. 
+/// @param board Board object
+/// @param tetromino Tetromino position, only updated if a kick test passes
+/// @param color Tetromino color
+/// @param rot Tetromino rotation, only updated if a kick test passes
+/// @param dir Positive for clockwise, negative for counter-clockwise
+/// @return Index of the kick test that passed, -1 if every test had a collision
+int8_t tetris_rotateTetromino(tetris_board_t* board, tetris_coord_t tetromino[4], tetris_color_t color, int8_t* rot, int8_t dir);
+
+
 // --- Constants --- //
 
 /* 
@@ -55,4 +127,10 @@ tetris_error_t tetris_calcGhostCoords(tetris_game_t* game);
  */
 extern const tetris_coord_t TETRIS_TETROMINO_ROTATE[8][4][4];
 
+/*
+ * Super Rotation System wall kick tests, tried in order until one has no collisions. 
+ * Indexed [IsCyan][CurrRotation][Direction][Test], direction 0 is clockwise and 1 is counter-clockwise. 
+ */
+extern const tetris_coord_t TETRIS_SRS_KICKS[2][4][2][5];
+
 #endif
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include <string.h>
+#include "btetris_finesse.h"
+
+// Used to keep rotation in the range of [0,3]
+#define MOD4(val) ((val) & 0b0011)
+
+// Number of tetromino states searched, rotation and position of the first block. Fits in a uint16_t at the largest playfield.
+#define TETRIS_FINESSE_STATES (4*(TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF)*TETRIS_WIDTH)
+#define TETRIS_FINESSE_IDX(rot, h, w) ((((rot)*(TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF)) + (h))*TETRIS_WIDTH + (w))
+
+// Marks a state that hasn't been reached yet
+#define TETRIS_FINESSE_UNVISITED 0xFFFF
+
+
+// --- Function Declarations --- //
+
+/// @brief Calculates the block offsets from the first block for every rotation of a tetromino
+/// @param tetromino Tetromino position
+/// @param color Tetromino color
+/// @param rot Tetromino rotation
+/// @param rel Offsets, indexed [Rotation][BlockIdx]
+void tetris_finesse_shape(const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, tetris_coord_t rel[4][4]);
+
+/// @brief Breadth first search over the states of the falling tetromino until the target placement is found
+/// @param board Board object with an active falling tetromino
+/// @param rot Target rotation
+/// @param target Landing position of the tetromino's first block
+/// @param sdrop Set to 0 to only search shifts and rotations
+/// @param cmds Array the commands are written to
+/// @param n Size of the cmds array
+/// @return Number of commands, -1 if the target can't be reached or the sequence doesn't fit in cmds
+int tetris_finesse_search(tetris_board_t* board, int8_t rot, tetris_coord_t target, int8_t sdrop, tetris_cmd_t* cmds, int n);
+
+
+// --- Function Definitions --- //
+
+// Precomputes the paths for every tetromino on an empty playfield
+void tetris_finesse_init(tetris_finesse_t* cache)
+{
+    tetris_board_t board;
+    tetris_coord_t rel[4][4];
+    tetris_coord_t tmpT[4];
+    tetris_coord_t target;
+    tetris_cmd_t cmds[TETRIS_FINESSE_LEN];
+    int8_t len, r, low;
+
+    memset(cache, 0, sizeof(tetris_finesse_t));
+    tetris_board_init(&board);
+
+    for (tetris_color_t color = TETRIS_CYAN; color <= TETRIS_RED; color++)
+    {
+        // Spawn tetromino on an empty playfield
+        board.fcol = color;
+        board.frot = 0;
+        board.fkick = -1;
+        board.fpos[0] = TETRIS_TETROMINO_START[color][0];
+        board.fpos[1] = TETRIS_TETROMINO_START[color][1];
+        board.fpos[2] = TETRIS_TETROMINO_START[color][2];
+        board.fpos[3] = TETRIS_TETROMINO_START[color][3];
+        tetris_finesse_shape(board.fpos, color, 0, rel);
+        cache->minh[color] = TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF;
+
+        for (int8_t rot = 0; rot < 4; rot++)
+        {
+            for (int8_t w = 0; w < TETRIS_WIDTH; w++)
+            {
+                cache->len[color][rot][w] = -1;
+
+                // 'O' tetromino only has one rotation
+                if (color == TETRIS_YELLOW && rot != 0) {
+                    continue;
+                }
+
+                // Target rests on the floor
+                target.h = 0;
+                target.w = w;
+                for (int i = 0; i < 4; i++)
+                {
+                    if (target.h < -rel[rot][i].h) {
+                        target.h = -rel[rot][i].h;
+                    }
+                }
+
+                len = tetris_finesse_search(&board, rot, target, 0, cmds, TETRIS_FINESSE_LEN);
+                if (len < 0) {
+                    continue;
+                }
+
+                // Replay path to find the rows it touches and where the hard drop starts
+                tmpT[0] = board.fpos[0];
+                tmpT[1] = board.fpos[1];
+                tmpT[2] = board.fpos[2];
+                tmpT[3] = board.fpos[3];
+                r = 0;
+                low = tmpT[3].h;
+                for (int c = 0; c < len - 1; c++)
+                {
+                    if (cmds[c] == TETRIS_CMD_LEFT || cmds[c] == TETRIS_CMD_RIGHT)
+                    {
+                        for (int i = 0; i < 4; i++) {
+                            tmpT[i].w += (cmds[c] == TETRIS_CMD_LEFT) ? -1 : 1;
+                        }
+                    }
+                    else {
+                        tetris_rotateTetromino(&board, tmpT, color, &r, (cmds[c] == TETRIS_CMD_ROTCW) ? 1 : -1);
+                    }
+
+                    for (int i = 0; i < 4; i++)
+                    {
+                        if (low > tmpT[i].h) {
+                            low = tmpT[i].h;
+                        }
+                    }
+                }
+
+                // Failed kick tests can reach two rows below the rotated tetromino
+                if (cache->minh[color] > low - 2) {
+                    cache->minh[color] = (low - 2 < 0) ? 0 : low - 2;
+                }
+
+                cache->fh[color][rot][w] = tmpT[0].h;
+                cache->len[color][rot][w] = len;
+                for (int c = 0; c < len; c++) {
+                    cache->path[color][rot][w][c] = cmds[c];
+                }
+            }
+        }
+    }
+}
+
+// Finds the shortest sequence of commands that moves the falling tetromino to a target placement
+int tetris_finesse(const tetris_finesse_t* cache, tetris_board_t* board, int8_t rot, tetris_coord_t target, tetris_cmd_t* cmds, int n)
+{
+    tetris_coord_t rel[4][4];
+    tetris_coord_t tmpT[4];
+    tetris_color_t color;
+    int8_t len, fh;
+    int8_t cached;
+
+    color = board->fcol;
+    if (color == TETRIS_BLANK || rot < 0 || rot > 3) {
+        return -1;
+    }
+    if (color == TETRIS_YELLOW) {
+        rot = board->frot;
+    }
+
+    // Cached paths only apply to a freshly spawned tetromino
+    cached = cache && board->frot == 0 && target.w >= 0 && target.w < TETRIS_WIDTH;
+    for (int i = 0; cached && i < 4; i++) {
+        cached = board->fpos[i].h == TETRIS_TETROMINO_START[color][i].h && board->fpos[i].w == TETRIS_TETROMINO_START[color][i].w;
+    }
+    if (cached) {
+        cached = cache->len[color][rot][target.w] >= 0;
+    }
+
+    // Rows the cached path moves through must be empty
+    for (int h = cached ? cache->minh[color] : TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF; h < TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF; h++)
+    {
+        if (board->rowcnt[h])
+        {
+            cached = 0;
+            break;
+        }
+    }
+
+    // Cached path is only correct if the hard drop lands on the target
+    if (cached)
+    {
+        len = cache->len[color][rot][target.w];
+        fh = cache->fh[color][rot][target.w];
+        tetris_finesse_shape(board->fpos, color, board->frot, rel);
+        for (int i = 0; i < 4; i++) {
+            tmpT[i].h = fh + rel[rot][i].h;
+            tmpT[i].w = target.w + rel[rot][i].w;
+        }
+
+        if (fh - tetris_dropDistance(board, tmpT) == target.h)
+        {
+            if (len > n) {
+                return -1;
+            }
+            for (int c = 0; c < len; c++) {
+                cmds[c] = cache->path[color][rot][target.w][c];
+            }
+            return len;
+        }
+    }
+
+    return tetris_finesse_search(board, rot, target, 1, cmds, n);
+}
+
+// Calculates the block offsets from the first block for every rotation of a tetromino
+void tetris_finesse_shape(const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, tetris_coord_t rel[4][4])
+{
+    tetris_coord_t tmpT[4];
+
+    tmpT[0] = tetromino[0];
+    tmpT[1] = tetromino[1];
+    tmpT[2] = tetromino[2];
+    tmpT[3] = tetromino[3];
+
+    // Wall kicks only translate the tetromino, the shape of each rotation never changes
+    for (int k = 0; k < 4; k++)
+    {
+        for (int i = 0; i < 4; i++) {
+            rel[rot][i] = tetris_subCoord(tmpT[i], tmpT[0]);
+        }
+        for (int i = 0; i < 4; i++) {
+            tmpT[i] = tetris_addCoord(tmpT[i], TETRIS_TETROMINO_ROTATE[color][rot][i]);
+        }
+        rot = MOD4(rot+1);
+    }
+}
+
+// Breadth first search over the states of the falling tetromino
+int tetris_finesse_search(tetris_board_t* board, int8_t rot, tetris_coord_t target, int8_t sdrop, tetris_cmd_t* cmds, int n)
+{
+    uint16_t parent[TETRIS_FINESSE_STATES];     // State each state was first reached from
+    int8_t pcmd[TETRIS_FINESSE_STATES];         // Command that reached each state
+    uint16_t queue[TETRIS_FINESSE_STATES];
+    int32_t head, tail;
+
+    tetris_coord_t rel[4][4];
+    tetris_coord_t curT[4];
+    tetris_coord_t tmpT[4];
+    tetris_color_t color;
+    uint16_t s, ns, start;
+    int8_t r, nr, h, w;
+    int len, c;
+
+    color = board->fcol;
+    tetris_finesse_shape(board->fpos, color, board->frot, rel);
+
+    memset(parent, 0xFF, sizeof(parent));
+    start = TETRIS_FINESSE_IDX(board->frot, board->fpos[0].h, board->fpos[0].w);
+    parent[start] = start;
+    queue[0] = start;
+    head = 0;
+    tail = 1;
+
+    while (head < tail)
+    {
+        s = queue[head++];
+        w = s % TETRIS_WIDTH;
+        h = (s / TETRIS_WIDTH) % (TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF);
+        r = s / (TETRIS_WIDTH*(TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF));
+        for (int i = 0; i < 4; i++) {
+            curT[i].h = h + rel[r][i].h;
+            curT[i].w = w + rel[r][i].w;
+        }
+
+        // States are visited in order of path length, first one that lands on the target is the shortest
+        if (r == rot && w == target.w && h - tetris_dropDistance(board, curT) == target.h)
+        {
+            len = 1;
+            for (ns = s; ns != start; ns = parent[ns]) {
+                len++;
+            }
+            if (len > n) {
+                return -1;
+            }
+
+            c = len - 1;
+            cmds[c] = TETRIS_CMD_HDROP;
+            for (ns = s; ns != start; ns = parent[ns]) {
+                cmds[--c] = pcmd[ns];
+            }
+
+            return len;
+        }
+
+        for (c = TETRIS_CMD_LEFT; c <= TETRIS_CMD_SDROP; c++)
+        {
+            tmpT[0] = curT[0];
+            tmpT[1] = curT[1];
+            tmpT[2] = curT[2];
+            tmpT[3] = curT[3];
+            nr = r;
+
+            switch (c)
+            {
+            case TETRIS_CMD_LEFT:
+            case TETRIS_CMD_RIGHT:
+                for (int i = 0; i < 4; i++) {
+                    tmpT[i].w += (c == TETRIS_CMD_LEFT) ? -1 : 1;
+                }
+                if (!tetris_collisionCheck(board, tmpT)) {
+                    continue;
+                }
+                break;
+
+            case TETRIS_CMD_ROTCW:
+            case TETRIS_CMD_ROTCCW:
+                // Rotation doesn't have an effect on the 'O' (yellow) tetromino
+                if (color == TETRIS_YELLOW) {
+                    continue;
+                }
+                if (tetris_rotateTetromino(board, tmpT, color, &nr, (c == TETRIS_CMD_ROTCW) ? 1 : -1) < 0) {
+                    continue;
+                }
+                break;
+
+            default:
+                if (!sdrop) {
+                    continue;
+                }
+                for (int i = 0; i < 4; i++) {
+                    tmpT[i].h -= 1;
+                }
+                if (!tetris_collisionCheck(board, tmpT)) {
+                    continue;
+                }
+                break;
+            }
+
+            ns = TETRIS_FINESSE_IDX(nr, tmpT[0].h, tmpT[0].w);
+            if (parent[ns] != TETRIS_FINESSE_UNVISITED) {
+                continue;
+            }
+            parent[ns] = s;
+            pcmd[ns] = c;
+            queue[tail++] = ns;
+        }
+    }
+
+    // Target can't be reached
+    return -1;
+}
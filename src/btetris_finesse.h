@@ -0,0 +1,46 @@
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_control.h"
+
+#ifndef __TETRIS_FINESSE__
+#define __TETRIS_FINESSE__
+
+// Longest cached path, shifting across the whole playfield plus two rotations and a hard drop
+#define TETRIS_FINESSE_LEN (TETRIS_WIDTH+3)
+
+
+// --- Finesse Structures --- //
+
+/*
+ * Precomputed paths from the spawn position to every rotation and column of an empty playfield.
+ * Indexed [Color][TargetRotation][TargetColumn], the column is the width of the tetromino's first block.
+ */
+typedef struct tetris_finesse
+{
+    int8_t  minh[8];                // Lowest row the cached paths of each tetromino can touch
+    int8_t  fh[8][4][TETRIS_WIDTH]; // Height of the first block before the hard drop
+    int8_t  len[8][4][TETRIS_WIDTH];    // Number of commands in each path, -1 if unreachable
+    int8_t  path[8][4][TETRIS_WIDTH][TETRIS_FINESSE_LEN];  // Commands of each path
+} tetris_finesse_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Precomputes the paths for every tetromino on an empty playfield
+/// @param cache Finesse cache
+void tetris_finesse_init(tetris_finesse_t* cache);
+
+/// @brief Finds the shortest sequence of commands that moves the falling tetromino to a target placement.
+/// Gravity is not simulated, the sequence always ends with a hard drop.
+/// The cache is used when the falling tetromino is at its spawn position and the rows its cached path can touch are empty.
+/// Other cases search every reachable position of the tetromino.
+/// @param cache Finesse cache, can be NULL to always search
+/// @param board Board object with an active falling tetromino
+/// @param rot Target rotation, ignored for the 'O' tetromino
+/// @param target Landing position of the tetromino's first block
+/// @param cmds Array the commands are written to
+/// @param n Size of the cmds array
+/// @return Number of commands, -1 if the target can't be reached or the sequence doesn't fit in cmds
+int tetris_finesse(const tetris_finesse_t* cache, tetris_board_t* board, int8_t rot, tetris_coord_t target, tetris_cmd_t* cmds, int n);
+
+#endif
@@ -1,18 +1,40 @@
+#include <string.h>
 #include "btetris_game.h"
 #include "btetris_control.h"
+#include "btetris_journal.h"
 
 #define MOD4(val) ((val) & 0b0011)
 
 // --- Function Declarations --- //
 
-/// @brief Pops a tetromino from the queue
+/// @brief Clears rows filled by a locked tetromino, updates score and stores the result in `game->lclear`
 /// @param game game struct
-/// @return Popped tetromino
-tetris_color_t tetris_tqueue_pop(tetris_game_t* game);
-
-/// @brief Swaps tetromino queue with shuffle queue
+/// @param tetromino Position of the locked tetromino, sorted by height
+/// @param color Color of the locked tetromino
+/// @param rot Rotation of the locked tetromino
+/// @param kick Kick test used by the tetromino's last movement, -1 if it wasn't a rotation
+void tetris_clearRows(tetris_game_t* game, const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, int8_t kick);
+
+/// @brief Classifies a locked tetromino using the 3-corner T-spin rule. Must be called before rows are cleared. 
+/// @param board board struct
+/// @param tetromino Position of the locked tetromino
+/// @param color Color of the locked tetromino
+/// @param rot Rotation of the locked tetromino
+/// @param kick Kick test used by the tetromino's last movement, -1 if it wasn't a rotation
+/// @return T-spin type
+tetris_tspin_t tetris_tspinCheck(tetris_board_t* board, const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, int8_t kick);
+
+/// @brief Updates the gravity increment after a level or curve change
 /// @param game game struct
-void tetris_tqueue_swap(tetris_game_t* game);
+void tetris_updateGravity(tetris_game_t* game);
+
+/// @brief Checks if a playfield position is filled, positions outside of the playfield count as filled
+/// @param board board struct
+/// @param h Height
+/// @param w Width
+/// @return 1 if filled, 0 if blank
+static inline int8_t tetris_isFilled(tetris_board_t* board, int h, int w);
+
 
 // Starts the tetris game
 tetris_error_t tetris_start(tetris_game_t* game)
@@ -38,22 +60,31 @@ tetris_error_t tetris_start(tetris_game_t* game)
         return TETRIS_SUCCESS;
     }
 
-    // Swap queues to get shuffled tetrominoes
-    tetris_tqueue_swap(game);
+    // Seed the tetromino sequence for this game
+    uint64_t seed;
+    seed = tetris_rand_next(game);
+    seed = (seed << 32) | tetris_rand_next(game);
+    tetris_bag_init(&game->bag, seed);
 
     // Populate piece preview
     for (int i = 0; i < TETRIS_PP_SIZE; i++)
     {
-        game->ppreview[i] = tetris_tqueue_pop(game);
+        game->ppreview[i] = tetris_bag_pop(&game->bag);
     }
+    game->pphead = 0;
 
     // Set falling tetromino
-    board->fcol = tetris_tqueue_pop(game);
+    board->fcol = tetris_bag_pop(&game->bag);
     board->fpos[0] = TETRIS_TETROMINO_START[board->fcol][0];
     board->fpos[1] = TETRIS_TETROMINO_START[board->fcol][1];
     board->fpos[2] = TETRIS_TETROMINO_START[board->fcol][2];
     board->fpos[3] = TETRIS_TETROMINO_START[board->fcol][3];
 
+    // Starting a game isn't a step that can be undone
+    if (game->journal) {
+        tetris_journal_clear(game->journal);
+    }
+
     // Flag game as running
     game->isStarted = 1;
     game->isRunning = 1;
@@ -82,14 +113,17 @@ tetris_error_t tetris_reset(tetris_game_t* game)
 
     // --- Reset board struct --- //
 
+    // Sentinel cells are never written, only the inside of the playfield needs clearing
     for (int h = 0; h <= board->pf_height; h++)
     {
         for (int w = 0; w < TETRIS_WIDTH; w++) 
         {
-            board->pf[h][w] = TETRIS_BLANK;
+            TETRIS_PF(board, h, w) = TETRIS_BLANK;
         }
+        board->rowcnt[h] = 0;
     }
     board->pf_height = 0;
+    board->cellcnt = 0;
 
     board->fpos[0] = (tetris_coord_t){-1, -1};
     board->fpos[1] = (tetris_coord_t){-1, -1};
@@ -97,6 +131,7 @@ tetris_error_t tetris_reset(tetris_game_t* game)
     board->fpos[3] = (tetris_coord_t){-1, -1};
 
     board->frot = 0;
+    board->fkick = -1;
     board->fcol = TETRIS_BLANK;
 
     board->gc_valid = 0;
@@ -108,24 +143,36 @@ tetris_error_t tetris_reset(tetris_game_t* game)
 
     // --- Initialize game struct --- //
 
-    game->level = 1;
+    game->level = game->slevel;
     game->score = 0;
     game->combo = -1;
     game->lines = 0;
+    game->lclear = (tetris_clear_t){0};
 
     for (int i = 0; i < TETRIS_PP_SIZE; i++) {
         game->ppreview[i] = TETRIS_BLANK;
     }
-    game->qidx = 0;
+    game->pphead = 0;
 
     game->tmicro = 0;
-    game->tdrop = 0;
+
+    game->gacc = 0;
+    tetris_updateGravity(game);
+
+    game->stmr = 0;
+    game->sdir = 0;
+    game->sheld = 0;
+
+    // Recorded steps can't be undone past a reset
+    if (game->journal) {
+        tetris_journal_clear(game->journal);
+    }
 
     return TETRIS_SUCCESS;
 }
 
 // Initializes a tetris game struct
-tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t randx_init)
+tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t seed)
 {
     // Error checking
     if (!game) {
@@ -136,33 +183,21 @@ tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t r
     }
 
 
-    // --- Initialize board struct --- //
-
-    for (int h = 0; h < TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF; h++)
-    {
-        for (int w = 0; w < TETRIS_WIDTH; w++) 
-        {
-            board->pf[h][w] = TETRIS_BLANK;
-        }
-    }
-    board->pf_height = 0;
-
-    board->fpos[0] = (tetris_coord_t){-1, -1};
-    board->fpos[1] = (tetris_coord_t){-1, -1};
-    board->fpos[2] = (tetris_coord_t){-1, -1};
-    board->fpos[3] = (tetris_coord_t){-1, -1};
-
-    board->frot = 0;
-    board->fcol = TETRIS_BLANK;
-
-    board->gc_valid = 0;
-    board->gc_pos[0] = (tetris_coord_t){-1, -1};
-    board->gc_pos[1] = (tetris_coord_t){-1, -1};
-    board->gc_pos[2] = (tetris_coord_t){-1, -1};
-    board->gc_pos[3] = (tetris_coord_t){-1, -1};
+    tetris_board_init(board);
 
+    return tetris_init_game(game, board, seed);
+}
 
-    // --- Initialize game struct --- //
+// Initializes a tetris game struct with a board that is already empty
+tetris_error_t tetris_init_game(tetris_game_t* game, tetris_board_t* board, int32_t seed)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    if (!board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
 
     game->isStarted = 0;
     game->isRunning = 0;
@@ -170,34 +205,39 @@ tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t r
 
     game->board = board;
 
+    game->slevel = 1;
     game->level = 1;
     game->score = 0;
     game->combo = -1;
     game->lines = 0;
+    game->lclear = (tetris_clear_t){0};
 
     for (int i = 0; i < TETRIS_PP_SIZE; i++) {
         game->ppreview[i] = TETRIS_BLANK;
     }
-    game->qidx = 0;
-    game->queue[0] = TETRIS_CYAN;
-    game->queue[1] = TETRIS_BLUE;
-    game->queue[2] = TETRIS_ORANGE;
-    game->queue[3] = TETRIS_YELLOW;
-    game->queue[4] = TETRIS_GREEN;
-    game->queue[5] = TETRIS_PURPLE;
-    game->queue[6] = TETRIS_RED;
-    game->shuffle_queue[0] = TETRIS_RED;
-    game->shuffle_queue[1] = TETRIS_ORANGE;
-    game->shuffle_queue[2] = TETRIS_YELLOW;
-    game->shuffle_queue[3] = TETRIS_GREEN;
-    game->shuffle_queue[4] = TETRIS_CYAN;
-    game->shuffle_queue[5] = TETRIS_BLUE;
-    game->shuffle_queue[6] = TETRIS_PURPLE;
+    game->pphead = 0;
+    tetris_bag_init(&game->bag, 0);
 
     game->tmicro = 0;
-    game->tdrop = 0;
 
-    game->randx = randx_init;
+    game->gacc = 0;
+    game->gcurve = TETRIS_GRAVITY_CURVE;
+    game->gcurve_len = TETRIS_GRAVITY_LEVELS;
+    tetris_updateGravity(game);
+
+    game->das = TETRIS_DAS;
+    game->arr = TETRIS_ARR;
+    game->stmr = 0;
+    game->sdir = 0;
+    game->sheld = 0;
+
+    tetris_rng_seed(&game->rng, seed);
+    game->randfunc = 0;
+    game->randstate = 0;
+    game->lockfunc = 0;
+    game->lockstate = 0;
+
+    game->journal = 0;
 
     return TETRIS_SUCCESS;
 }
@@ -258,9 +298,6 @@ tetris_error_t tetris_tick(tetris_game_t* game, uint64_t tmicro)
         return TETRIS_ERROR_NULL_BOARD;
     }
 
-    // Shuffle the shuffle queue 
-    tetris_rand_swap(game);
-
     // Dont worry about handling game logic if the game isn't running. 
     if (game->isGameover)
     {
@@ -270,214 +307,546 @@ tetris_error_t tetris_tick(tetris_game_t* game, uint64_t tmicro)
         return TETRIS_SUCCESS;
     }
 
+    // Everything this tick changes is undone together
+    tetris_journal_begin(game);
+
     // If current falling tetromino is "blank" then a tetromino was recently locked. 
     // Need to check if a row needs to be cleared and generate a new tetromino to fall
     if (board->fcol == TETRIS_BLANK) 
     {
-        // --- Locate rows to clear --- //
+        // Fallen tetromino is still stored in fpos, its color can be found in the playfield
+        tetris_clearRows(game, board->fpos, TETRIS_PF(board, board->fpos[0].h, board->fpos[0].w), board->frot, board->fkick);
 
-        // NOTE: Tetromino starting positions and rotation table are designed so board->fpos is always sorted by height
+        // Lock callback can change the playfield before the next tetromino spawns
+        if (game->lockfunc && game->lockfunc(game, game->lockstate) == TETRIS_ERROR_GAME_OVER)
+        {
+            if (game->journal) {
+                tetris_journal_state(game);
+            }
+            game->isRunning = 0;
+            game->isGameover = 1;
 
-        // Keep track of prev and current row
-        int row_prev, row_curr;
-        row_prev = -1;
+            return TETRIS_ERROR_GAME_OVER;
+        }
 
-        // List of rows to clear
-        int row_cidx = 0;
-        int row_clist[4] = {-1, -1, -1, -1};
+        // --- Pop Tetromino --- //
 
-        // Loop through tetromino coords
-        for (int i = 0; i < 4; i++) 
+        if (game->journal) 
         {
-            row_curr = board->fpos[i].h;
+            tetris_journal_piece(game);
+            tetris_journal_pop(game);
+        }
 
-            // If coord height is equal to a previous height, row was already checked
-            if (row_prev != row_curr)
+        // Get the color of the next falling tetromino from piece preview
+        board->fcol = game->ppreview[game->pphead];
+
+        // Refill the emptied slot from the bag, it is now the end of the preview
+        game->ppreview[game->pphead] = tetris_bag_pop(&game->bag);
+        game->pphead = (game->pphead == TETRIS_PP_SIZE-1) ? 0 : game->pphead+1;
+
+        // Copy starting position for next falling tetromino
+        board->frot = 0;
+        board->fkick = -1;
+        board->fpos[0] = TETRIS_TETROMINO_START[board->fcol][0];
+        board->fpos[1] = TETRIS_TETROMINO_START[board->fcol][1];
+        board->fpos[2] = TETRIS_TETROMINO_START[board->fcol][2];
+        board->fpos[3] = TETRIS_TETROMINO_START[board->fcol][3];
+
+        // If there is a colision with the starting position, the game is over
+        for (int i = 3; i >= 0; i--) 
+        {
+            if (TETRIS_PF(board, board->fpos[i].h, board->fpos[i].w) != TETRIS_BLANK) 
             {
-                int w = 0;
-                int rowClearable = 1;
+                if (game->journal) {
+                    tetris_journal_state(game);
+                }
+                game->isRunning = 0;
+                game->isGameover = 1;
+                board->fcol = TETRIS_BLANK;
 
-                // Check if row is full
-                while (w < TETRIS_WIDTH && rowClearable) 
-                {
-                    // Say row is not clearable if empty position is found
-                    if (board->pf[row_curr][w] == TETRIS_BLANK) {
-                        rowClearable = 0;
-                    }
-                    // Otherwise, check next position
-                    else {
-                        w++;
-                    }
+                if (board->pf_height < board->fpos[0].h) {
+                    board->pf_height = board->fpos[0].h;
                 }
 
-                // If row is clearable, save the row index to clear it later
-                if (rowClearable) 
+                return TETRIS_ERROR_GAME_OVER;
+            }
+        }
+    } // end `if (board->fcol == TETRIS_BLANK)`
+
+    // Update game runtime
+    game->tmicro += tmicro;
+
+    // Repeat held shift key once delayed auto shift runs out
+    if (game->sdir && board->fcol != TETRIS_BLANK) 
+    {
+        int64_t stmr = (int64_t)game->stmr - (int64_t)((tmicro > INT32_MAX) ? INT32_MAX : tmicro);
+
+        if (stmr <= 0)
+        {
+            // Instant auto repeat, jump straight to the wall or stack
+            if (game->arr <= 0) 
+            {
+                int8_t dist = tetris_shiftDistance(board, board->fpos, game->sdir) * game->sdir;
+                if (dist)
                 {
-                    row_clist[row_cidx] = row_curr;
-                    row_cidx++;
+                    if (game->journal) {
+                        tetris_journal_piece(game);
+                    }
+                    board->fpos[0].w += dist;
+                    board->fpos[1].w += dist;
+                    board->fpos[2].w += dist;
+                    board->fpos[3].w += dist;
+                    board->fkick = -1;
+                    board->gc_valid = 0;
                 }
+                stmr = 0;
+            }
+            // Shift once for every auto repeat period that passed
+            else 
+            {
+                tetris_coord_t tmpT[4];
+                int8_t shifted = 0;
+                while (stmr <= 0)
+                {
+                    tmpT[0] = board->fpos[0];
+                    tmpT[1] = board->fpos[1];
+                    tmpT[2] = board->fpos[2];
+                    tmpT[3] = board->fpos[3];
+                    tmpT[0].w += game->sdir;
+                    tmpT[1].w += game->sdir;
+                    tmpT[2].w += game->sdir;
+                    tmpT[3].w += game->sdir;
+
+                    // Stay charged against the wall
+                    if (!tetris_collisionCheck(board, tmpT)) 
+                    {
+                        stmr = 0;
+                        break;
+                    }
 
-                // Update row_prev
-                row_prev = board->fpos[i].h;
+                    if (game->journal && !shifted) {
+                        tetris_journal_piece(game);
+                    }
+                    shifted = 1;
+
+                    board->fpos[0] = tmpT[0];
+                    board->fpos[1] = tmpT[1];
+                    board->fpos[2] = tmpT[2];
+                    board->fpos[3] = tmpT[3];
+                    board->fkick = -1;
+                    board->gc_valid = 0;
+                    stmr += game->arr;
+                }
             }
         }
+        game->stmr = (int32_t)stmr;
+    }
 
-        int row_ccnt = row_cidx;    // Number of rows to clear
-        row_cidx = 0;               // Reset cidx
+    // Accumulate gravity as a 32.32 fixed point row count, integer part is the number of rows to drop
+    int drop_cnt;
+    if (game->ginc == TETRIS_GRAVITY_20G || tmicro > UINT32_MAX) 
+    {
+        drop_cnt = TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF;
+    }
+    else 
+    {
+        uint64_t gacc = (uint64_t)game->ginc * (uint32_t)tmicro + game->gacc;
+        game->gacc = (uint32_t)gacc;
 
-        // Update line clear score
-        switch (row_ccnt)
-        {
-        case 1:
-            game->score += 100 * game->level;
-            break;
-        case 2: 
-            game->score += 300 * game->level;
-            break;
-        case 3: 
-            game->score += 500 * game->level;
-            break;
-        case 4:
-            game->score += 800 * game->level;
-            break;
-        default:
-            break;
+        // Can't drop further than the height of the playfield
+        gacc >>= 32;
+        drop_cnt = (gacc > TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF) ? TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF : (int)gacc;
+    }
+    
+    // Move the tetromino straight to the lowest row gravity allows
+    if (drop_cnt > 0) 
+    {
+        // Landing position is cached in the ghost piece until the tetromino moves sideways or rotates
+        tetris_calcGhostCoords(game);
+
+        int drop_max = board->fpos[0].h - board->gc_pos[0].h;
+
+        // 20G lands the tetromino without locking it, it only locks on a later tick if it is still on the stack
+        if (game->ginc == TETRIS_GRAVITY_20G && drop_max > 0) {
+            drop_cnt = drop_max;
         }
 
-        // Update combo scoring
-        if (row_ccnt == 0) {
-            game->combo = -1;
+        // Dropping past the landing position locks the tetromino, same as a soft drop with a collision
+        int8_t lock = (drop_cnt > drop_max);
+        if (lock) {
+            drop_cnt = drop_max;
         }
-        else {
-            game->combo += 1;
+
+        if (game->journal && (drop_cnt > 0 || lock)) {
+            tetris_journal_piece(game);
         }
-        
-        if (game->combo >= 0)
+
+        if (drop_cnt > 0) 
         {
-            game->score += 50 * game->combo * game->level;
+            board->fpos[0].h -= drop_cnt;
+            board->fpos[1].h -= drop_cnt;
+            board->fpos[2].h -= drop_cnt;
+            board->fpos[3].h -= drop_cnt;
+            board->fkick = -1;
         }
 
-        game->lines += row_ccnt;
-        if (game->lines >= 10) 
+        if (lock) 
         {
-            game->level += 1;
-            game->lines -= 10;
+            if (game->journal) {
+                tetris_journal_lock(game);
+            }
+            tetris_lockTetromino(board);
         }
+    }
+
+    return TETRIS_SUCCESS;
+}
+
+// Places a tetromino and hard drops it
+tetris_error_t tetris_step(tetris_game_t* game, tetris_color_t color, int8_t rot, int8_t col)
+{
+    tetris_board_t* board;
+    tetris_coord_t tmpT[4];
+    int8_t dw, dh;
 
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    board = game->board;
+    if (!board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+    if (color < TETRIS_CYAN || color > TETRIS_RED || rot < 0 || rot > 3) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
 
-        // --- Clear rows --- //
+    // Same game over check as spawning in `tetris_tick()`
+    for (int i = 3; i >= 0; i--) 
+    {
+        tmpT[i] = TETRIS_TETROMINO_START[color][i];
+        if (TETRIS_PF(board, tmpT[i].h, tmpT[i].w) != TETRIS_BLANK) {
+            return TETRIS_ERROR_GAME_OVER;
+        }
+    }
 
-        while (row_cidx < row_ccnt)
-        {
-            // Count number of adjacent rows
-            int adj_cnt;
-            for (adj_cnt = 1; adj_cnt < row_ccnt-row_cidx; adj_cnt++)
-            {
-                // If the next row to clear isn't adjacent, break out of loop
-                if (row_clist[row_cidx] != row_clist[row_cidx + adj_cnt] - adj_cnt)
-                {
-                    break;
-                }
-            } 
+    // Rotate at the spawn position, kicks only happen when the stack reaches the spawn rows
+    int8_t r = 0;
+    for (int k = 0; k < rot; k++) 
+    {
+        if (tetris_rotateTetromino(board, tmpT, color, &r, 1) < 0) {
+            return TETRIS_ERROR_COLLISION;
+        }
+    }
 
-            // Move rows above cidx down
-            for (int h = row_clist[row_cidx] + 1; h <= board->pf_height; h++)
-            {
-                // Loop through current row
-                for (int w = 0; w < TETRIS_WIDTH; w++) 
-                {
-                    // Move selected row down by the count of adjacent rows 
-                    board->pf[h - adj_cnt][w] = board->pf[h][w];
-                }
+    // Shift straight to the column if the stack is below the tetromino, otherwise one column at a time like the control functions
+    dw = col - tmpT[0].w;
+    if (tmpT[3].h > board->pf_height)
+    {
+        for (int i = 0; i < 4; i++) 
+        {
+            tmpT[i].w += dw;
+            if (tmpT[i].w < 0 || tmpT[i].w >= TETRIS_WIDTH) {
+                return TETRIS_ERROR_COLLISION;
             }
-
-            // Clear top rows that werent overwritten by the loop above
-            for (int h = board->pf_height; h > board->pf_height - adj_cnt; h--) 
-            {
-                // Loop through current row to clear it
-                for (int w = 0; w < TETRIS_WIDTH; w++) 
-                {
-                    board->pf[h][w] = TETRIS_BLANK;
-                }
+        }
+    }
+    else 
+    {
+        int8_t step = (dw < 0) ? -1 : 1;
+        for (; dw != 0; dw -= step)
+        {
+            for (int i = 0; i < 4; i++) {
+                tmpT[i].w += step;
             }
+            if (!tetris_collisionCheck(board, tmpT)) {
+                return TETRIS_ERROR_COLLISION;
+            }
+        }
+    }
 
-            // Update cidx
-            row_cidx += adj_cnt;
-
-            // Update pf height
-            board->pf_height -= adj_cnt;
+    // Rows above the playfield height are empty, skip straight past them
+    dh = tmpT[3].h - (board->pf_height + 1);
+    if (dh > 0)
+    {
+        for (int i = 0; i < 4; i++) {
+            tmpT[i].h -= dh;
         }
+    }
+    dh = tetris_dropDistance(board, tmpT);
 
+    // Lock at the landing position
+    tetris_journal_begin(game);
+    if (game->journal) {
+        tetris_journal_piece(game);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        board->fpos[i] = tmpT[i];
+        board->fpos[i].h -= dh;
+    }
+    board->fcol = color;
+    board->frot = r;
+    board->fkick = -1;
+    if (game->journal) {
+        tetris_journal_lock(game);
+    }
+    tetris_lockTetromino(board);
 
-        // --- Pop Tetromino --- //
+    tetris_clearRows(game, board->fpos, color, r, -1);
 
-        // Get the color of the next falling tetromino from piece preview
-        board->fcol = game->ppreview[0];
+    return TETRIS_SUCCESS;
+}
+
+// Sets the level a game starts at
+tetris_error_t tetris_set_level(tetris_game_t* game, int8_t level)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    if (level < 0) {
+        level = 0;
+    }
+
+    game->slevel = level;
+
+    // Level of a game in progress is left alone
+    if (!game->isStarted) 
+    {
+        game->level = level;
+        tetris_updateGravity(game);
+    }
 
-        // Shift tetrominoes in piece preview 
-        for (int i = 1; i < TETRIS_PP_SIZE; i++)
+    return TETRIS_SUCCESS;
+}
+
+// Sets the gravity curve
+tetris_error_t tetris_set_gravity(tetris_game_t* game, const uint32_t* curve, int8_t len)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+
+    // Restore default curve
+    if (!curve || len < 1) 
+    {
+        curve = TETRIS_GRAVITY_CURVE;
+        len = TETRIS_GRAVITY_LEVELS;
+    }
+
+    game->gcurve = curve;
+    game->gcurve_len = len;
+    tetris_updateGravity(game);
+
+    return TETRIS_SUCCESS;
+}
+
+// Sets auto shift timing
+tetris_error_t tetris_set_autoshift(tetris_game_t* game, int32_t das, int32_t arr)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+
+    game->das = (das < 0) ? 0 : das;
+    game->arr = (arr < 0) ? 0 : arr;
+
+    return TETRIS_SUCCESS;
+}
+
+// Updates the gravity increment after a level or curve change
+void tetris_updateGravity(tetris_game_t* game)
+{
+    if (game->level < game->gcurve_len) {
+        game->ginc = game->gcurve[game->level];
+    }
+    else {
+        game->ginc = game->gcurve[game->gcurve_len-1];
+    }
+}
+
+// Gets a tetromino from the piece preview without modifying it
+tetris_color_t tetris_ppreview_peek(const tetris_game_t* game, int k)
+{
+    int idx;
+
+    // Error checking
+    if (!game || !game->isStarted || k < 0) {
+        return TETRIS_BLANK;
+    }
+
+    // Past the end of the preview, look ahead in the bag
+    if (k >= TETRIS_PP_SIZE) {
+        return tetris_bag_get(&game->bag, tetris_bag_tell(&game->bag) + (k - TETRIS_PP_SIZE));
+    }
+
+    idx = game->pphead + k;
+    if (idx >= TETRIS_PP_SIZE) {
+        idx -= TETRIS_PP_SIZE;
+    }
+
+    return game->ppreview[idx];
+}
+
+// Clears rows filled by a locked tetromino and updates score
+void tetris_clearRows(tetris_game_t* game, const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, int8_t kick)
+{
+    tetris_board_t* board = game->board;
+    tetris_clear_t result;
+
+
+    // --- Locate rows to clear --- //
+
+    // NOTE: Tetromino starting positions and rotation table are designed so tetromino coords are always sorted by height
+
+    // List of rows to clear, from highest to lowest
+    int row_ccnt = 0;
+    int row_clist[4] = {-1, -1, -1, -1};
+    int row_prev = -1;
+
+    // Row is full when its filled cell count matches the width, no need to scan it
+    for (int i = 0; i < 4; i++) 
+    {
+        if (tetromino[i].h != row_prev && board->rowcnt[tetromino[i].h] == TETRIS_WIDTH) 
         {
-            game->ppreview[i-1] = game->ppreview[i];
+            row_clist[row_ccnt] = tetromino[i].h;
+            row_ccnt++;
         }
+        row_prev = tetromino[i].h;
+    }
 
-        // Pop tetromino from queue
-        game->ppreview[TETRIS_PP_SIZE-1] = tetris_tqueue_pop(game);
+    // T-spin corners have to be checked before rows move
+    result.tspin = tetris_tspinCheck(board, tetromino, color, rot, kick);
+    result.lines = row_ccnt;
 
-        // Copy starting position for next falling tetromino
-        board->frot = 0;
-        board->fpos[0] = TETRIS_TETROMINO_START[board->fcol][0];
-        board->fpos[1] = TETRIS_TETROMINO_START[board->fcol][1];
-        board->fpos[2] = TETRIS_TETROMINO_START[board->fcol][2];
-        board->fpos[3] = TETRIS_TETROMINO_START[board->fcol][3];
+    if (game->journal) 
+    {
+        if (row_ccnt) {
+            tetris_journal_rows(game, row_clist, row_ccnt);
+        }
+        tetris_journal_score(game);
+    }
 
-        // If there is a colision with the starting position, the game is over
-        for (int i = 3; i >= 0; i--) 
+
+    // --- Clear rows --- //
+
+    int row_cidx = 0;
+    while (row_cidx < row_ccnt)
+    {
+        // Count number of adjacent rows
+        int adj_cnt;
+        for (adj_cnt = 1; adj_cnt < row_ccnt-row_cidx; adj_cnt++)
         {
-            if (board->pf[board->fpos[i].h][board->fpos[i].w] != TETRIS_BLANK) 
+            // If the next row to clear isn't adjacent, break out of loop
+            if (row_clist[row_cidx] != row_clist[row_cidx + adj_cnt] - adj_cnt)
             {
-                game->isRunning = 0;
-                game->isGameover = 1;
-                board->fcol = TETRIS_BLANK;
+                break;
+            }
+        } 
 
-                if (board->pf_height < board->fpos[0].h) {
-                    board->pf_height = board->fpos[0].h;
-                }
+        // Move rows above cidx down by the count of adjacent rows, sentinel columns are the same in every row
+        for (int h = row_clist[row_cidx] + 1; h <= board->pf_height; h++)
+        {
+            memcpy(&TETRIS_PF(board, h - adj_cnt, 0), &TETRIS_PF(board, h, 0), TETRIS_WIDTH*sizeof(tetris_color_t));
+            board->rowcnt[h - adj_cnt] = board->rowcnt[h];
+        }
 
-                return TETRIS_ERROR_GAME_OVER;
+        // Clear top rows that werent overwritten by the loop above
+        for (int h = board->pf_height; h > board->pf_height - adj_cnt; h--) 
+        {
+            // Loop through current row to clear it
+            for (int w = 0; w < TETRIS_WIDTH; w++) 
+            {
+                TETRIS_PF(board, h, w) = TETRIS_BLANK;
             }
+            board->rowcnt[h] = 0;
         }
-    } // end `if (board->fcol == TETRIS_BLANK)`
 
-    // Update game runtime
-    game->tmicro += tmicro;
+        // Update cidx
+        row_cidx += adj_cnt;
 
-    // Calculate the number of times tetromino should be dropped
-    int drop_cnt;   
-    if (game->level > 19) 
-    {
-        drop_cnt = (game->tmicro - game->tdrop) / TETRIS_SPEED_CURVE[19];
-        game->tdrop += drop_cnt * TETRIS_SPEED_CURVE[19];
+        // Update pf height and filled cell count
+        board->pf_height -= adj_cnt;
+        board->cellcnt -= adj_cnt * TETRIS_WIDTH;
     }
-    else 
-    {
-        drop_cnt = (game->tmicro - game->tdrop) / TETRIS_SPEED_CURVE[game->level];
-        game->tdrop += drop_cnt * TETRIS_SPEED_CURVE[game->level];
+
+    // Playfield is empty after clearing rows, perfect clear
+    result.pclear = (row_ccnt > 0 && board->cellcnt == 0);
+
+
+    // --- Update score --- //
+
+    // Line clear and T-spin score
+    result.points = TETRIS_SCORE_CLEAR[result.tspin][row_ccnt] * game->level;
+
+    // Perfect clear bonus
+    if (result.pclear) {
+        result.points += TETRIS_SCORE_PCLEAR[row_ccnt] * game->level;
+    }
+
+    // Update combo scoring
+    if (row_ccnt == 0) {
+        game->combo = -1;
+    }
+    else {
+        game->combo += 1;
     }
     
-    // Drop the tetromino
-    tetris_error_t retval;
-    for (int i = 0; i < drop_cnt; i++) 
+    if (game->combo >= 0)
     {
-        // Try to perform soft drop
-        retval = tetris_sdrop(game);
+        result.points += 50 * game->combo * game->level;
+    }
+    result.combo = game->combo;
 
-        // If there is a colision, the tetromino is now locked, can't drop it anymore 
-        if (retval == TETRIS_ERROR_COLLISION) {
-            break;
-        }
+    game->score += result.points;
+
+    game->lines += row_ccnt;
+    if (game->lines >= 10) 
+    {
+        game->level += (game->level < INT8_MAX);
+        game->lines -= 10;
+        tetris_updateGravity(game);
     }
 
-    return TETRIS_SUCCESS;
+    game->lclear = result;
+}
+
+// Classifies a locked tetromino using the 3-corner T-spin rule
+tetris_tspin_t tetris_tspinCheck(tetris_board_t* board, const tetris_coord_t tetromino[4], tetris_color_t color, int8_t rot, int8_t kick)
+{
+    tetris_coord_t center;
+    int8_t corners;
+    tetris_tspin_t tspin;
+
+    // Only a T tetromino whose last movement was a rotation can T-spin
+    if (color != TETRIS_PURPLE || kick < 0) {
+        return TETRIS_TSPIN_NONE;
+    }
+
+    // Build mask of filled corners around the T's center
+    center = tetromino[TETRIS_TSPIN_CENTER[rot]];
+    corners  = tetris_isFilled(board, center.h+1, center.w-1);
+    corners |= tetris_isFilled(board, center.h+1, center.w+1) << 1;
+    corners |= tetris_isFilled(board, center.h-1, center.w-1) << 2;
+    corners |= tetris_isFilled(board, center.h-1, center.w+1) << 3;
+
+    tspin = TETRIS_TSPIN_TABLE[rot][corners];
+
+    // Last kick test moves the T far enough that it always counts as a full T-spin
+    if (tspin == TETRIS_TSPIN_MINI && kick == 4) {
+        tspin = TETRIS_TSPIN_FULL;
+    }
+
+    return tspin;
+}
+
+// Checks if a playfield position is filled
+static inline int8_t tetris_isFilled(tetris_board_t* board, int h, int w)
+{
+    return TETRIS_PF(board, h, w) != TETRIS_BLANK;
 }
 
 // Adds entropy to the random number generator
@@ -494,102 +863,108 @@ tetris_error_t tetris_rand_entropy(tetris_game_t* game, int entropy)
         return TETRIS_ERROR_NULL_BOARD;
     }
     
+#if TETRIS_RAND_ENTROPY
+    uint32_t mix;
+
     // Add user generated entropy
-    game->randx += entropy;
+    mix = entropy;
 
     // Get entropy from game runtime
-    game->randx += game->tmicro;
+    mix += game->tmicro;
 
     // Get entropy from tetromino position
     int rot = board->frot;
-    game->randx += board->fpos[0].h ^ board->fpos[rot].w;
-    game->randx += (board->fpos[1].h ^ board->fpos[MOD4(rot+1)].w) >> 8;
-    game->randx += (board->fpos[2].h ^ board->fpos[MOD4(rot+2)].w) >> 16;
-    game->randx += (board->fpos[3].h ^ board->fpos[MOD4(rot+3)].w) >> 24;
+    mix += (uint32_t)(board->fpos[0].h ^ board->fpos[rot].w);
+    mix += (uint32_t)(board->fpos[1].h ^ board->fpos[MOD4(rot+1)].w) << 8;
+    mix += (uint32_t)(board->fpos[2].h ^ board->fpos[MOD4(rot+2)].w) << 16;
+    mix += (uint32_t)(board->fpos[3].h ^ board->fpos[MOD4(rot+3)].w) << 24;
+
+    // Custom random functions handle their own entropy
+    tetris_rng_entropy(&game->rng, mix);
+#endif
 
     return TETRIS_SUCCESS;
 }
 
-// Swaps two tetrominoes in the shuffle queue using the RNG
-tetris_error_t tetris_rand_swap(tetris_game_t* game)
+// Replaces the built-in RNG with a custom random function
+tetris_error_t tetris_rand_setfunc(tetris_game_t* game, tetris_randfunc_t randfunc, void* state)
 {
-    tetris_color_t temp;
-    int idx1, idx2;
-
     // Error checking
     if (!game) {
         return TETRIS_ERROR_NULL_GAME;
     }
 
-    // Find swap indexes
-    idx1 = game->randx % 7;             // Get random position from randx
-    idx1 = (idx1<0) ? idx1+7 : idx1;    // Get mod instead of remainder
-    idx2 = game->qidx;                  // Other swap position from queue idx, guarantees every piece gets swapped around
-    
-
-    // Swap 
-    temp = game->shuffle_queue[idx1];
-    game->shuffle_queue[idx1] = game->shuffle_queue[idx2];
-    game->shuffle_queue[idx2] = temp;
-
-    // Update randx
-    game->randx = game->randx + TETRIS_RAND_INCR;
+    game->randfunc = randfunc;
+    game->randstate = state;
 
     return TETRIS_SUCCESS;
 }
 
-// Pops a tetromino from the queue
-tetris_color_t tetris_tqueue_pop(tetris_game_t* game)
+// Sets a function called after every locked tetromino
+tetris_error_t tetris_set_lockfunc(tetris_game_t* game, tetris_lockfunc_t lockfunc, void* state)
 {
-    tetris_color_t retval;
-
-    retval = game->queue[game->qidx];
-    game->qidx++;
-
-    if (game->qidx > 6) 
-    {
-        tetris_tqueue_swap(game);
-
-        // Reset queue length
-        game->qidx = 0;
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
     }
 
-    return retval;
+    game->lockfunc = lockfunc;
+    game->lockstate = state;
+
+    return TETRIS_SUCCESS;
 }
 
-// Swaps tetromino queue with shuffle queue
-void tetris_tqueue_swap(tetris_game_t* game)
+// Gets 32 random bits from the game's RNG
+uint32_t tetris_rand_next(tetris_game_t* game)
 {
-    // Swap queues
-    tetris_color_t tempc;
-    for (int i = 0; i < 7; i++)
-    {
-        tempc = game->queue[i];
-        game->queue[i] = game->shuffle_queue[i];
-        game->shuffle_queue[i] = tempc;
+    if (game->randfunc) {
+        return game->randfunc(game->randstate);
     }
+
+    return tetris_rng_next(&game->rng);
 }
 
-// tick() calls per line drop
-const int64_t TETRIS_SPEED_CURVE[20] = {
-    (1.23915737299  * 1000000), // 0
-    (1              * 1000000), // 1
-    (0.793          * 1000000), // 2
-    (0.617796       * 1000000), // 3
-    (0.472729139000 * 1000000), // 4
-    (0.355196928256 * 1000000), // 5
-    (0.262003549978 * 1000000), // 6
-    (0.189677245333 * 1000000), // 7
-    (0.134734730816 * 1000000), // 8
-    (0.093882248904 * 1000000), // 9
-    (0.064151584960 * 1000000), // 10
-    (0.042976258297 * 1000000), // 11
-    (0.028217677801 * 1000000), // 12
-    (0.018153328544 * 1000000), // 13
-    (0.011439342347 * 1000000), // 14
-    (0.007058616221 * 1000000), // 15
-    (0.004263556954 * 1000000), // 16
-    (0.002520083970 * 1000000), // 17
-    (0.001457138733 * 1000000), // 18
-    (0.000823906896 * 1000000), // 19
+// Index of the T's center block for each rotation
+const int8_t TETRIS_TSPIN_CENTER[4] = {2, 1, 1, 2};
+
+// T-spin type for every corner mask. Bits: 0 = top left, 1 = top right, 2 = bottom left, 3 = bottom right
+const int8_t TETRIS_TSPIN_TABLE[4][16] = {
+    {0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 2, 0, 1, 1, 2},  // 0, front corners: top
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 1, 2, 2},  // R, front corners: right
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 2, 2, 2},  // 2, front corners: bottom
+    {0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 1, 0, 2, 1, 2},  // L, front corners: left
+};
+
+// Points per level for clearing rows, indexed [tetris_tspin_t][Lines]
+const int32_t TETRIS_SCORE_CLEAR[3][5] = {
+    {0, 100, 300, 500, 800},    // No T-spin
+    {100, 200, 400, 0, 0},      // T-spin mini
+    {400, 800, 1200, 1600, 0},  // T-spin
+};
+
+// Perfect clear bonus points per level, indexed [Lines]
+const int32_t TETRIS_SCORE_PCLEAR[5] = {0, 800, 1200, 1800, 2000};
+
+// Default gravity curve, rows per microsecond as a 32 bit fraction
+const uint32_t TETRIS_GRAVITY_CURVE[TETRIS_GRAVITY_LEVELS] = {
+    TETRIS_GRAVITY(1.23915737299),  // 0
+    TETRIS_GRAVITY(1),              // 1
+    TETRIS_GRAVITY(0.793),          // 2
+    TETRIS_GRAVITY(0.617796),       // 3
+    TETRIS_GRAVITY(0.472729139000), // 4
+    TETRIS_GRAVITY(0.355196928256), // 5
+    TETRIS_GRAVITY(0.262003549978), // 6
+    TETRIS_GRAVITY(0.189677245333), // 7
+    TETRIS_GRAVITY(0.134734730816), // 8
+    TETRIS_GRAVITY(0.093882248904), // 9
+    TETRIS_GRAVITY(0.064151584960), // 10
+    TETRIS_GRAVITY(0.042976258297), // 11
+    TETRIS_GRAVITY(0.028217677801), // 12
+    TETRIS_GRAVITY(0.018153328544), // 13
+    TETRIS_GRAVITY(0.011439342347), // 14
+    TETRIS_GRAVITY(0.007058616221), // 15
+    TETRIS_GRAVITY(0.004263556954), // 16
+    TETRIS_GRAVITY(0.002520083970), // 17
+    TETRIS_GRAVITY(0.001457138733), // 18
+    TETRIS_GRAVITY(0.000823906896), // 19
 };
\ No newline at end of file
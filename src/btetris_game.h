@@ -1,5 +1,8 @@
+#include <stddef.h>
 #include <stdint.h>
 #include "btetris_board.h"
+#include "btetris_rng.h"
+#include "btetris_bag.h"
 
 #ifndef __TETRIS_GAME__
 #define __TETRIS_GAME__
@@ -11,17 +14,37 @@
     #define TETRIS_PP_SIZE 2
 #elif TETRIS_PP_SIZE < 1
     #error invalid piece preview size, too small
-#elif TETRIS_PP_SIZE > 6
+#elif TETRIS_PP_SIZE > 32
     #error invalid piece preview size, too large
 #endif
 
-// Random INCR. Dont want to be 0 or multiples of 7 because it would produce a constant value
-#ifndef TETRIS_RAND_INCR
-    #define TETRIS_RAND_INCR 2
-#elif TETRIS_RAND_INCR < 1
-    #error Random increment is too small
-#elif TETRIS_RAND_INCR > 6
-    #error Random increment is too large
+// Number of levels in the default gravity curve
+#define TETRIS_GRAVITY_LEVELS 20
+
+// Converts seconds per row drop to a gravity curve value (32 bit fraction of a row per microsecond)
+#define TETRIS_GRAVITY(sec) ((uint32_t)(4294967296.0 / ((sec) * 1000000)))
+
+// Gravity curve value that drops the tetromino as far as possible every tick, it locks on the tick after it lands
+#define TETRIS_GRAVITY_20G UINT32_MAX
+
+// Default delayed auto shift, microseconds a shift key is held before it repeats
+#ifndef TETRIS_DAS
+    #define TETRIS_DAS 167000
+#endif
+
+// Default auto repeat rate, microseconds between repeated shifts. 0 shifts to the wall instantly
+#ifndef TETRIS_ARR
+    #define TETRIS_ARR 33000
+#endif
+
+// Size of a cache line in bytes
+#ifndef TETRIS_CACHE_LINE
+    #define TETRIS_CACHE_LINE 64
+#endif
+
+// Set to 0 to ignore entropy, RNG output will then only depend on the seed
+#ifndef TETRIS_RAND_ENTROPY
+    #define TETRIS_RAND_ENTROPY 1
 #endif
 
 
@@ -35,49 +58,130 @@ typedef enum tetris_error {
     TETRIS_ERROR_COLLISION,
     TETRIS_ERROR_GAME_OVER,
     TETRIS_ERROR_GAME_PAUSED,
-    TETRIS_ERROR_NOT_STARTED
+    TETRIS_ERROR_NOT_STARTED,
+    TETRIS_ERROR_INVALID_INPUT,
+    TETRIS_ERROR_JOURNAL_EMPTY,
+    TETRIS_ERROR_ROLLBACK_STALL,
+    TETRIS_ERROR_PUB_BUSY
 } tetris_error_t;
 
+typedef enum tetris_tspin {
+    TETRIS_TSPIN_NONE = 0,
+    TETRIS_TSPIN_MINI,
+    TETRIS_TSPIN_FULL
+} tetris_tspin_t;
+
+// Undo journal, see btetris_journal.h
+struct tetris_journal;
+
+// Game object, defined below
+struct tetris_game;
+
+/// @brief Called by `tetris_tick()` after the rows of a locked tetromino are cleared, before the next tetromino spawns
+/// @param game Game object, `lclear` holds the result of the lock
+/// @param state State pointer given to `tetris_set_lockfunc()`
+/// @return TETRIS_ERROR_GAME_OVER ends the game, anything else continues
+typedef tetris_error_t (*tetris_lockfunc_t)(struct tetris_game* game, void* state);
+
+// Result of a locked tetromino
+typedef struct tetris_clear {
+    int8_t  lines;      // Number of rows cleared
+    int8_t  tspin;      // tetris_tspin_t
+    int8_t  pclear;     // True if the playfield is empty after clearing rows
+    int8_t  combo;      // Combo after this lock
+    int32_t points;     // Points awarded for this lock
+} tetris_clear_t;
+
+/*
+ * Fields read by every `tetris_tick()` come first and fit in one cache line, as long as the game is allocated
+ * at a `TETRIS_CACHE_LINE` boundary (see btetris_pool.h). Fields only used when a tetromino locks,
+ * by input functions or by the frontend follow after it.
+ */
 typedef struct tetris_game
 {
+    // --- Hot, read every tick --- //
+
+    // Tetris board
+    tetris_board_t* board;
+
+    // Undo journal, NULL when changes aren't recorded
+    struct tetris_journal* journal;
+
+    // Timing
+    int64_t tmicro;
+
+    // Gravity
+    uint32_t gacc;  // Fraction of a row accumulated towards the next drop
+    uint32_t ginc;  // Rows per microsecond for the current level, 32 bit fraction
+
+    // Auto shift
+    int32_t arr;    // Auto repeat rate, microseconds. 0 shifts to the wall instantly
+    int32_t stmr;   // Microseconds until the held shift key repeats
+    int8_t  sdir;   // Direction of the active shift key. -1 left, 1 right, 0 none
+    int8_t  sheld;  // Held shift keys. Bit 0 is left, bit 1 is right
+
     // Game state
     int8_t isStarted;   // Set after start(), cleared after init() or reset()
     int8_t isRunning;   // Set by start() and unpause(). Cleared by pause(), tick(), init() or reset()
     int8_t isGameover;  // Set by tick(), cleared by init() or reset()
 
-    // Tetris board
-    tetris_board_t* board;
+
+    // --- Cold --- //
 
     // Score
     int8_t  level;
-    int64_t score;
+    int8_t  slevel; // Level a game starts at
     int8_t  combo;  // Number of line clears in a row - 1
     int8_t  lines;  // Lines cleared in this level
+    int64_t score;
+    tetris_clear_t lclear;  // Result of the last locked tetromino, updated by tick()
 
     // Tetromino queue
-    tetris_color_t  ppreview[TETRIS_PP_SIZE];   // Piece preview
-    int8_t          qidx;               // Position of next color in queue
-    tetris_color_t  queue[7];           // Queue that feeds into ppreview
-    tetris_color_t  shuffle_queue[7];   // Gets swapped with queue when it empties
+    int8_t          ppreview[TETRIS_PP_SIZE];   // Piece preview, ring buffer of tetris_color_t starting at pphead
+    int8_t          pphead;                     // Index of the next tetromino in ppreview
+    tetris_bag_t    bag;                        // Bag generator that feeds into ppreview
 
-    // Timing
-    int64_t tmicro;
-    int64_t tdrop;
+    // Gravity curve
+    const uint32_t* gcurve;     // Gravity curve, indexed by level
+    int8_t          gcurve_len; // Number of levels in gravity curve
+
+    // Auto shift
+    int32_t das;    // Delayed auto shift, microseconds
 
     // RNG state
-    int32_t randx;
+    tetris_rng_t        rng;        // Built-in generator, used when randfunc is NULL
+    tetris_randfunc_t   randfunc;   // Custom random function
+    void*               randstate;  // State given to custom random function
+
+    // Lock callback
+    tetris_lockfunc_t   lockfunc;   // Called after every lock, NULL if unused
+    void*               lockstate;  // State given to lock callback
 
 } tetris_game_t;
 
+// Memory budgets. Hot fields must end within the first cache line, `level` is the first cold field.
+// The game is 168 bytes on 64 bit targets with the default preview and bag sizes, the budget leaves 8 bytes for padding
+// and grows with TETRIS_PP_SIZE and TETRIS_BAG_SIZE.
+_Static_assert(offsetof(tetris_game_t, level) <= TETRIS_CACHE_LINE, "tetris_game_t hot fields exceed a cache line");
+_Static_assert(sizeof(tetris_game_t) <= 176 + (TETRIS_PP_SIZE - 2) + (TETRIS_BAG_SIZE - 7), "tetris_game_t exceeds its size budget");
+
 
 // --- Function Declarations --- //
 
 /// @brief Initializes a tetris game struct
 /// @param game Pointer to allocated game struct
 /// @param board Pointer to allocated board struct
-/// @param randx_init Starting number for RNG
+/// @param seed Seed for the built-in RNG
+/// @return Error code
+tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t seed);
+
+/// @brief Initializes a tetris game struct without touching the board.
+/// Board must already be empty, from `tetris_board_init()` or a previous `tetris_reset()`.
+/// @param game Pointer to allocated game struct
+/// @param board Pointer to empty board struct
+/// @param seed Seed for the built-in RNG
 /// @return Error code
-tetris_error_t tetris_init(tetris_game_t* game, tetris_board_t* board, int32_t randx_init);
+tetris_error_t tetris_init_game(tetris_game_t* game, tetris_board_t* board, int32_t seed);
 
 /// @brief Resets a game to a playable state without reseting random state
 /// @param game Game object
@@ -105,21 +209,88 @@ tetris_error_t tetris_unpause(tetris_game_t* game);
 /// @return Error code
 tetris_error_t tetris_tick(tetris_game_t* game, uint64_t tmicro);
 
+/// @brief Places a tetromino and hard drops it, then clears rows and updates score the same way `tetris_tick()` does. 
+/// Skips timing, entropy, game state checks and the piece preview, meant for rollouts on a copy of a game. 
+/// Result matches rotating clockwise at the spawn position, shifting to the column and hard dropping. 
+/// Placements are never T-spins. Don't mix with `tetris_tick()` on the same game. 
+/// @param game Game object, only the board and score fields are used
+/// @param color Tetromino to place, [TETRIS_CYAN:TETRIS_RED]
+/// @param rot Number of clockwise rotations, [0:3]
+/// @param col Column of the tetromino's first block after rotating
+/// @return TETRIS_ERROR_GAME_OVER if the spawn position is blocked, TETRIS_ERROR_COLLISION if the placement is blocked,
+/// TETRIS_ERROR_INVALID_INPUT if color isn't a tetromino or rot is out of range
+tetris_error_t tetris_step(tetris_game_t* game, tetris_color_t color, int8_t rot, int8_t col);
+
+/// @brief Sets the level a game starts at. Current level is also set if the game isn't started. 
+/// @param game Game object
+/// @param level Starting level, [0:127]
+/// @return Error code
+tetris_error_t tetris_set_level(tetris_game_t* game, int8_t level);
+
+/// @brief Sets the gravity curve. Levels past the end of the curve use the last value. 
+/// @param game Game object
+/// @param curve Rows per microsecond for each level as a 32 bit fraction, see `TETRIS_GRAVITY()`. 
+/// NULL restores the default curve. Array must stay allocated while the game uses it. 
+/// @param len Number of levels in the curve
+/// @return Error code
+tetris_error_t tetris_set_gravity(tetris_game_t* game, const uint32_t* curve, int8_t len);
+
+/// @brief Sets auto shift timing used while a shift key is held, see `tetris_keydown()`
+/// @param game Game object
+/// @param das Delayed auto shift, microseconds a shift key is held before it repeats
+/// @param arr Auto repeat rate, microseconds between repeated shifts. 0 shifts to the wall instantly
+/// @return Error code
+tetris_error_t tetris_set_autoshift(tetris_game_t* game, int32_t das, int32_t arr);
+
+/// @brief Gets a tetromino from the piece preview without modifying it. 
+/// Indexes past the end of the preview are looked up from the bag. 
+/// @param game Game object
+/// @param k Position in the preview, 0 is the next tetromino to fall
+/// @return Tetromino color, TETRIS_BLANK if game is NULL, not started or k is negative
+tetris_color_t tetris_ppreview_peek(const tetris_game_t* game, int k);
+
 /// @brief Adds entropy to the random number generator
 /// @param game Game object
 /// @param entropy Any integer
 /// @return Error code
 tetris_error_t tetris_rand_entropy(tetris_game_t* game, int entropy);
 
-/// @brief Swaps two tetrominoes in the shuffle queue using the RNG
+/// @brief Replaces the built-in RNG with a custom random function
+/// @param game Game object
+/// @param randfunc Custom random function, NULL restores the built-in RNG
+/// @param state Pointer passed to every randfunc call
+/// @return Error code
+tetris_error_t tetris_rand_setfunc(tetris_game_t* game, tetris_randfunc_t randfunc, void* state);
+
+/// @brief Sets a function called after every locked tetromino, see `tetris_lockfunc_t`. 
+/// Changes made by the callback aren't recorded by the undo journal. 
 /// @param game Game object
+/// @param lockfunc Lock callback, NULL removes it
+/// @param state Pointer passed to every lockfunc call
 /// @return Error code
-tetris_error_t tetris_rand_swap(tetris_game_t* game);
+tetris_error_t tetris_set_lockfunc(tetris_game_t* game, tetris_lockfunc_t lockfunc, void* state);
+
+/// @brief Gets 32 random bits from the game's RNG
+/// @param game Game object, must not be NULL
+/// @return Random number
+uint32_t tetris_rand_next(tetris_game_t* game);
 
 
 // --- CONSTANTS --- //
 
-// tick() calls per line drop
-extern const int64_t TETRIS_SPEED_CURVE[20];
+// Index of the T's center block in a T tetromino, indexed [Rotation]
+extern const int8_t TETRIS_TSPIN_CENTER[4];
+
+// T-spin type (tetris_tspin_t) for a mask of filled corners around the T's center, indexed [Rotation][Mask]
+extern const int8_t TETRIS_TSPIN_TABLE[4][16];
+
+// Points per level for clearing rows, indexed [tetris_tspin_t][Lines]
+extern const int32_t TETRIS_SCORE_CLEAR[3][5];
+
+// Perfect clear bonus points per level, indexed [Lines]
+extern const int32_t TETRIS_SCORE_PCLEAR[5];
+
+// Default gravity curve, rows per microsecond as a 32 bit fraction
+extern const uint32_t TETRIS_GRAVITY_CURVE[TETRIS_GRAVITY_LEVELS];
 
 #endif
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include <string.h>
+#include "btetris_journal.h"
+
+/*
+ * Entries are stored back to back as [len:2][type:1][payload:len][len:2].
+ * Length is stored at both ends so the journal can be walked in both directions.
+ * Every step starts with an empty TETRIS_JOURNAL_STEP entry.
+ */
+#define TETRIS_JOURNAL_HEAD 3
+#define TETRIS_JOURNAL_TAIL 2
+
+// Payload sizes
+#define TETRIS_JOURNAL_PIECE_LEN    11
+#define TETRIS_JOURNAL_LOCK_LEN     10
+#define TETRIS_JOURNAL_POP_LEN      7
+#define TETRIS_JOURNAL_SCORE_LEN    (sizeof(int64_t) + 3 + sizeof(tetris_clear_t) + sizeof(uint32_t))
+#define TETRIS_JOURNAL_STATE_LEN    4
+
+
+// --- Journal Structures --- //
+
+typedef enum tetris_jtype {
+    TETRIS_JOURNAL_STEP = 0,    // Start of a step
+    TETRIS_JOURNAL_PIECE,       // Falling tetromino position, color, rotation and kick
+    TETRIS_JOURNAL_LOCK,        // Cells written by a locked tetromino
+    TETRIS_JOURNAL_ROWS,        // Contents of cleared rows
+    TETRIS_JOURNAL_POP,         // Piece preview slot, head and bag position
+    TETRIS_JOURNAL_SCORE,       // Score, level, combo, lines, line clear result and gravity
+    TETRIS_JOURNAL_STATE        // Game state flags and playfield height
+} tetris_jtype_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Reserves space for an entry at the end of the journal, drops the oldest steps if needed
+/// @param journal Journal object
+/// @param type Entry type
+/// @param len Payload length
+/// @return Payload pointer, NULL if the entry can't be recorded
+uint8_t* tetris_journal_push(tetris_journal_t* journal, tetris_jtype_t type, int len);
+
+/// @brief Drops the oldest step
+/// @param journal Journal object
+/// @return 1 if a step was dropped, 0 if only the step being recorded is left
+int8_t tetris_journal_drop(tetris_journal_t* journal);
+
+/// @brief Applies an entry
+/// @param game Game object
+/// @param type Entry type
+/// @param p Entry payload, swapped entries are updated with the overwritten state
+/// @param undo 1 when undoing, 0 when redoing
+void tetris_journal_apply(tetris_game_t* game, tetris_jtype_t type, uint8_t* p, int8_t undo);
+
+/// @brief Writes the state of an entry type to a payload
+/// @param game Game object
+/// @param type Entry type, only types that are swapped
+/// @param p Payload
+void tetris_journal_save(tetris_game_t* game, tetris_jtype_t type, uint8_t* p);
+
+/// @brief Restores the state of an entry type from a payload
+/// @param game Game object
+/// @param type Entry type, only types that are swapped
+/// @param p Payload
+void tetris_journal_load(tetris_game_t* game, tetris_jtype_t type, const uint8_t* p);
+
+/// @brief Reads a 16 bit length
+static inline int tetris_journal_len(const uint8_t* p);
+
+
+// --- Function Definitions --- //
+
+// Initializes a journal
+void tetris_journal_init(tetris_journal_t* journal, uint8_t* buf, int32_t size)
+{
+    journal->buf = buf;
+    journal->size = size;
+    tetris_journal_clear(journal);
+}
+
+// Drops every recorded step
+void tetris_journal_clear(tetris_journal_t* journal)
+{
+    journal->pos = 0;
+    journal->end = 0;
+    journal->step = -1;
+    journal->split = 1;
+    journal->skip = 0;
+}
+
+// Starts recording changes of a game into a journal
+tetris_error_t tetris_set_journal(tetris_game_t* game, tetris_journal_t* journal)
+{
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+
+    game->journal = journal;
+    if (journal) {
+        tetris_journal_clear(journal);
+    }
+
+    return TETRIS_SUCCESS;
+}
+
+// Reverts the changes of the last recorded step
+tetris_error_t tetris_undo(tetris_game_t* game)
+{
+    tetris_journal_t* journal;
+    tetris_jtype_t type;
+    int32_t off;
+
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    if (!game->board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+    journal = game->journal;
+    if (!journal || journal->pos == 0) {
+        return TETRIS_ERROR_JOURNAL_EMPTY;
+    }
+
+    // Apply entries in reverse until the start of the step
+    off = journal->pos;
+    do
+    {
+        off -= tetris_journal_len(&journal->buf[off - TETRIS_JOURNAL_TAIL]) + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+        type = journal->buf[off + 2];
+        if (type != TETRIS_JOURNAL_STEP) {
+            tetris_journal_apply(game, type, &journal->buf[off + TETRIS_JOURNAL_HEAD], 1);
+        }
+    }
+    while (type != TETRIS_JOURNAL_STEP);
+
+    journal->pos = off;
+    journal->step = -1;
+    journal->split = 1;
+
+    return TETRIS_SUCCESS;
+}
+
+// Applies the changes of the last undone step again
+tetris_error_t tetris_redo(tetris_game_t* game)
+{
+    tetris_journal_t* journal;
+    tetris_jtype_t type;
+    int32_t off;
+
+    // Error checking
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    if (!game->board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+    journal = game->journal;
+    if (!journal || journal->pos == journal->end) {
+        return TETRIS_ERROR_JOURNAL_EMPTY;
+    }
+
+    // Skip the step entry, then apply entries until the next step
+    off = journal->pos + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    while (off < journal->end)
+    {
+        type = journal->buf[off + 2];
+        if (type == TETRIS_JOURNAL_STEP) {
+            break;
+        }
+
+        tetris_journal_apply(game, type, &journal->buf[off + TETRIS_JOURNAL_HEAD], 0);
+        off += tetris_journal_len(&journal->buf[off]) + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    }
+
+    journal->pos = off;
+    journal->step = -1;
+    journal->split = 1;
+
+    return TETRIS_SUCCESS;
+}
+
+// Records the falling tetromino
+void tetris_journal_piece(tetris_game_t* game)
+{
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_PIECE, TETRIS_JOURNAL_PIECE_LEN);
+    if (p) {
+        tetris_journal_save(game, TETRIS_JOURNAL_PIECE, p);
+    }
+}
+
+// Records the falling tetromino being locked into the playfield
+void tetris_journal_lock(tetris_game_t* game)
+{
+    tetris_board_t* board = game->board;
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_LOCK, TETRIS_JOURNAL_LOCK_LEN);
+    if (!p) {
+        return;
+    }
+
+    // Locked cells were blank, only their position and color is needed
+    for (int i = 0; i < 4; i++)
+    {
+        p[i*2] = board->fpos[i].h;
+        p[i*2+1] = board->fpos[i].w;
+    }
+    p[8] = board->fcol;
+    p[9] = board->pf_height;
+}
+
+// Records rows before they are cleared
+void tetris_journal_rows(tetris_game_t* game, const int rows[4], int n)
+{
+    tetris_board_t* board = game->board;
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_ROWS, 1 + n + n*TETRIS_WIDTH);
+    if (!p) {
+        return;
+    }
+
+    // Stored from lowest to highest, the order rows are put back in
+    p[0] = n;
+    for (int i = 0; i < n; i++)
+    {
+        int h = rows[n-1-i];
+
+        p[1+i] = h;
+        for (int w = 0; w < TETRIS_WIDTH; w++) {
+            p[1 + n + i*TETRIS_WIDTH + w] = TETRIS_PF(board, h, w);
+        }
+    }
+}
+
+// Records the piece preview and bag before a tetromino is popped
+void tetris_journal_pop(tetris_game_t* game)
+{
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_POP, TETRIS_JOURNAL_POP_LEN);
+    if (p)
+    {
+        // Popped slot never changes, other fields are swapped
+        p[0] = game->pphead;
+        tetris_journal_save(game, TETRIS_JOURNAL_POP, p);
+    }
+}
+
+// Records score, level and line clear result
+void tetris_journal_score(tetris_game_t* game)
+{
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_SCORE, TETRIS_JOURNAL_SCORE_LEN);
+    if (p) {
+        tetris_journal_save(game, TETRIS_JOURNAL_SCORE, p);
+    }
+}
+
+// Records game state flags and playfield height
+void tetris_journal_state(tetris_game_t* game)
+{
+    uint8_t* p = tetris_journal_push(game->journal, TETRIS_JOURNAL_STATE, TETRIS_JOURNAL_STATE_LEN);
+    if (p) {
+        tetris_journal_save(game, TETRIS_JOURNAL_STATE, p);
+    }
+}
+
+// Reserves space for an entry at the end of the journal
+uint8_t* tetris_journal_push(tetris_journal_t* journal, tetris_jtype_t type, int len)
+{
+    uint8_t* p;
+    int need;
+
+    if (journal->skip) {
+        return 0;
+    }
+
+    // Recording a new change drops every undone step
+    journal->end = journal->pos;
+
+    need = len + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    if (journal->split) {
+        need += TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    }
+
+    // Make room by dropping the oldest steps, give up on this step if it is larger than the buffer
+    while (journal->end + need > journal->size)
+    {
+        if (!tetris_journal_drop(journal))
+        {
+            tetris_journal_clear(journal);
+            journal->skip = 1;
+            return 0;
+        }
+    }
+
+    // Start a new step
+    if (journal->split)
+    {
+        p = &journal->buf[journal->end];
+        p[0] = p[1] = p[3] = p[4] = 0;
+        p[2] = TETRIS_JOURNAL_STEP;
+        journal->step = journal->end;
+        journal->end += TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+        journal->split = 0;
+    }
+
+    p = &journal->buf[journal->end];
+    p[0] = len & 0xFF;
+    p[1] = len >> 8;
+    p[2] = type;
+    p[TETRIS_JOURNAL_HEAD + len] = len & 0xFF;
+    p[TETRIS_JOURNAL_HEAD + len + 1] = len >> 8;
+
+    journal->end += len + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    journal->pos = journal->end;
+
+    return p + TETRIS_JOURNAL_HEAD;
+}
+
+// Drops the oldest step
+int8_t tetris_journal_drop(tetris_journal_t* journal)
+{
+    int32_t off;
+
+    // Step being recorded can't be dropped
+    if (journal->end == 0 || (!journal->split && journal->step == 0)) {
+        return 0;
+    }
+
+    // Find the start of the second step
+    off = TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    while (off < journal->end && journal->buf[off + 2] != TETRIS_JOURNAL_STEP) {
+        off += tetris_journal_len(&journal->buf[off]) + TETRIS_JOURNAL_HEAD + TETRIS_JOURNAL_TAIL;
+    }
+
+    memmove(journal->buf, &journal->buf[off], journal->end - off);
+    journal->end -= off;
+    journal->pos -= off;
+    if (journal->step >= 0) {
+        journal->step -= off;
+    }
+
+    return 1;
+}
+
+// Applies an entry
+void tetris_journal_apply(tetris_game_t* game, tetris_jtype_t type, uint8_t* p, int8_t undo)
+{
+    tetris_board_t* board = game->board;
+    uint8_t tmp[TETRIS_JOURNAL_SCORE_LEN];
+    int8_t height;
+    int n, h;
+
+    switch (type)
+    {
+    case TETRIS_JOURNAL_LOCK:
+        for (int i = 0; i < 4; i++)
+        {
+            TETRIS_PF(board, (int8_t)p[i*2], (int8_t)p[i*2+1]) = undo ? TETRIS_BLANK : p[8];
+            board->rowcnt[(int8_t)p[i*2]] += undo ? -1 : 1;
+        }
+        board->cellcnt += undo ? -4 : 4;
+
+        height = board->pf_height;
+        board->pf_height = p[9];
+        p[9] = height;
+        board->gc_valid = 0;
+        break;
+
+    case TETRIS_JOURNAL_ROWS:
+        n = p[0];
+
+        // Put rows back from lowest to highest, moving everything above them up
+        if (undo)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                h = p[1+i];
+                for (int k = board->pf_height; k >= h; k--)
+                {
+                    memcpy(board->pf[k+1+TETRIS_PF_PAD], board->pf[k+TETRIS_PF_PAD], sizeof(board->pf[0]));
+                    board->rowcnt[k+1] = board->rowcnt[k];
+                }
+                for (int w = 0; w < TETRIS_WIDTH; w++) {
+                    TETRIS_PF(board, h, w) = p[1 + n + i*TETRIS_WIDTH + w];
+                }
+                board->rowcnt[h] = TETRIS_WIDTH;
+                board->pf_height++;
+                board->cellcnt += TETRIS_WIDTH;
+            }
+        }
+        // Clear rows again from highest to lowest, same result as `tetris_clearRows()`
+        else
+        {
+            for (int i = n-1; i >= 0; i--)
+            {
+                h = p[1+i];
+                for (int k = h+1; k <= board->pf_height; k++)
+                {
+                    memcpy(board->pf[k-1+TETRIS_PF_PAD], board->pf[k+TETRIS_PF_PAD], sizeof(board->pf[0]));
+                    board->rowcnt[k-1] = board->rowcnt[k];
+                }
+                for (int w = 0; w < TETRIS_WIDTH; w++) {
+                    TETRIS_PF(board, board->pf_height, w) = TETRIS_BLANK;
+                }
+                board->rowcnt[board->pf_height] = 0;
+                board->pf_height--;
+                board->cellcnt -= TETRIS_WIDTH;
+            }
+        }
+        board->gc_valid = 0;
+        break;
+
+    // Other entries swap the recorded state with the current state
+    case TETRIS_JOURNAL_PIECE:
+    case TETRIS_JOURNAL_POP:
+    case TETRIS_JOURNAL_SCORE:
+    case TETRIS_JOURNAL_STATE:
+        tmp[0] = p[0];
+        tetris_journal_save(game, type, tmp);
+        tetris_journal_load(game, type, p);
+        memcpy(p, tmp, (type == TETRIS_JOURNAL_PIECE) ? TETRIS_JOURNAL_PIECE_LEN :
+                       (type == TETRIS_JOURNAL_POP) ? TETRIS_JOURNAL_POP_LEN :
+                       (type == TETRIS_JOURNAL_SCORE) ? TETRIS_JOURNAL_SCORE_LEN : TETRIS_JOURNAL_STATE_LEN);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Writes the state of an entry type to a payload
+void tetris_journal_save(tetris_game_t* game, tetris_jtype_t type, uint8_t* p)
+{
+    tetris_board_t* board = game->board;
+    int32_t tell;
+
+    switch (type)
+    {
+    case TETRIS_JOURNAL_PIECE:
+        for (int i = 0; i < 4; i++)
+        {
+            p[i*2] = board->fpos[i].h;
+            p[i*2+1] = board->fpos[i].w;
+        }
+        p[8] = board->fcol;
+        p[9] = board->frot;
+        p[10] = board->fkick;
+        break;
+
+    case TETRIS_JOURNAL_POP:
+        // p[0] is the popped slot
+        p[1] = game->ppreview[p[0]];
+        p[2] = game->pphead;
+        tell = tetris_bag_tell(&game->bag);
+        memcpy(&p[3], &tell, sizeof(tell));
+        break;
+
+    case TETRIS_JOURNAL_SCORE:
+        memcpy(p, &game->score, sizeof(game->score));
+        p += sizeof(game->score);
+        *p++ = game->level;
+        *p++ = game->combo;
+        *p++ = game->lines;
+        memcpy(p, &game->lclear, sizeof(game->lclear));
+        p += sizeof(game->lclear);
+        memcpy(p, &game->ginc, sizeof(game->ginc));
+        break;
+
+    case TETRIS_JOURNAL_STATE:
+        p[0] = game->isStarted;
+        p[1] = game->isRunning;
+        p[2] = game->isGameover;
+        p[3] = board->pf_height;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Restores the state of an entry type from a payload
+void tetris_journal_load(tetris_game_t* game, tetris_jtype_t type, const uint8_t* p)
+{
+    tetris_board_t* board = game->board;
+    int32_t tell;
+
+    switch (type)
+    {
+    case TETRIS_JOURNAL_PIECE:
+        for (int i = 0; i < 4; i++)
+        {
+            board->fpos[i].h = p[i*2];
+            board->fpos[i].w = p[i*2+1];
+        }
+        board->fcol = p[8];
+        board->frot = p[9];
+        board->fkick = p[10];
+        board->gc_valid = 0;
+        break;
+
+    case TETRIS_JOURNAL_POP:
+        game->ppreview[p[0]] = p[1];
+        game->pphead = p[2];
+        memcpy(&tell, &p[3], sizeof(tell));
+        tetris_bag_seek(&game->bag, tell);
+        break;
+
+    case TETRIS_JOURNAL_SCORE:
+        memcpy(&game->score, p, sizeof(game->score));
+        p += sizeof(game->score);
+        game->level = *p++;
+        game->combo = *p++;
+        game->lines = *p++;
+        memcpy(&game->lclear, p, sizeof(game->lclear));
+        p += sizeof(game->lclear);
+        memcpy(&game->ginc, p, sizeof(game->ginc));
+        break;
+
+    case TETRIS_JOURNAL_STATE:
+        game->isStarted = p[0];
+        game->isRunning = p[1];
+        game->isGameover = p[2];
+        board->pf_height = p[3];
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Reads a 16 bit length
+static inline int tetris_journal_len(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+
+#ifndef __TETRIS_JOURNAL__
+#define __TETRIS_JOURNAL__
+
+
+// --- Journal Structures --- //
+
+/*
+ * Undo journal, records the state each change overwrites into a caller provided buffer.
+ * Changes made by one library call are grouped into a step, `tetris_undo()` and `tetris_redo()` move one step at a time.
+ * The oldest steps are dropped when the buffer is full.
+ * Timers, auto shift and random state are not recorded.
+ * Copies of a game share its journal, set `journal` to NULL in copies that shouldn't record.
+ */
+typedef struct tetris_journal
+{
+    uint8_t*    buf;    // Caller provided buffer
+    int32_t     size;   // Size of buf in bytes
+    int32_t     pos;    // End of the last applied step
+    int32_t     end;    // End of the last recorded step, steps between pos and end can be redone
+    int32_t     step;   // Start of the step being recorded, -1 if none
+    int8_t      split;  // Set when the next entry starts a new step
+    int8_t      skip;   // Set when the current step didn't fit in the buffer, rest of it isn't recorded
+} tetris_journal_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Initializes a journal
+/// @param journal Journal object
+/// @param buf Buffer to record into, must stay allocated while the journal is used
+/// @param size Size of buf in bytes
+void tetris_journal_init(tetris_journal_t* journal, uint8_t* buf, int32_t size);
+
+/// @brief Drops every recorded step
+/// @param journal Journal object
+void tetris_journal_clear(tetris_journal_t* journal);
+
+/// @brief Starts recording changes of a game into a journal. The journal is cleared.
+/// @param game Game object
+/// @param journal Journal object, NULL stops recording
+/// @return Error code
+tetris_error_t tetris_set_journal(tetris_game_t* game, tetris_journal_t* journal);
+
+/// @brief Reverts the changes of the last recorded step
+/// @param game Game object
+/// @return Error code, TETRIS_ERROR_JOURNAL_EMPTY if there is nothing to undo
+tetris_error_t tetris_undo(tetris_game_t* game);
+
+/// @brief Applies the changes of the last undone step again. Recording a new step drops every undone step.
+/// @param game Game object
+/// @return Error code, TETRIS_ERROR_JOURNAL_EMPTY if there is nothing to redo
+tetris_error_t tetris_redo(tetris_game_t* game);
+
+
+// --- Recording Functions --- //
+
+// Called by the library before it changes game state, game must have a journal.
+
+/// @brief Records the falling tetromino
+/// @param game Game object
+void tetris_journal_piece(tetris_game_t* game);
+
+/// @brief Records the falling tetromino being locked into the playfield
+/// @param game Game object
+void tetris_journal_lock(tetris_game_t* game);
+
+/// @brief Records rows before they are cleared
+/// @param game Game object
+/// @param rows Rows to clear, from highest to lowest
+/// @param n Number of rows
+void tetris_journal_rows(tetris_game_t* game, const int rows[4], int n);
+
+/// @brief Records the piece preview and bag before a tetromino is popped
+/// @param game Game object
+void tetris_journal_pop(tetris_game_t* game);
+
+/// @brief Records score, level and line clear result
+/// @param game Game object
+void tetris_journal_score(tetris_game_t* game);
+
+/// @brief Records game state flags and playfield height
+/// @param game Game object
+void tetris_journal_state(tetris_game_t* game);
+
+/// @brief Starts a new step, changes recorded until the next call are undone together
+/// @param game Game object
+static inline void tetris_journal_begin(tetris_game_t* game);
+
+
+// Starts a new step
+static inline void tetris_journal_begin(tetris_game_t* game)
+{
+    if (game->journal)
+    {
+        game->journal->split = 1;
+        game->journal->skip = 0;
+    }
+}
+
+#endif
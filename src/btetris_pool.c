@@ -0,0 +1,158 @@
+#include "btetris_pool.h"
+
+// Builds a handle from a slab index and generation
+#define TETRIS_POOL_HANDLE(idx, gen) (((tetris_handle_t)(gen) << 32) | (uint32_t)(idx))
+
+
+// --- Function Declarations --- //
+
+/// @brief Clears a slab's board and puts it at the front of the free list
+/// @param pool Pool object
+/// @param idx Slab index
+void tetris_pool_release(tetris_pool_t* pool, int32_t idx);
+
+
+// --- Function Definitions --- //
+
+// Calculates the arena size needed for a number of games
+size_t tetris_pool_arena_size(int32_t count)
+{
+    if (count < 0) {
+        return 0;
+    }
+
+    // Arena might not be aligned, leave room to move the first slab
+    return (size_t)count * sizeof(tetris_slab_t) + TETRIS_POOL_ALIGN - 1;
+}
+
+// Splits an arena into slabs
+tetris_error_t tetris_pool_init(tetris_pool_t* pool, void* arena, size_t size)
+{
+    uintptr_t start, skip;
+    size_t count;
+
+    // Error checking
+    if (!pool || !arena) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    // Align first slab to a cache line
+    start = (uintptr_t)arena;
+    skip = (TETRIS_POOL_ALIGN - (start % TETRIS_POOL_ALIGN)) % TETRIS_POOL_ALIGN;
+    if (size < skip + sizeof(tetris_slab_t)) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    count = (size - skip) / sizeof(tetris_slab_t);
+    if (count > INT32_MAX) {
+        count = INT32_MAX;
+    }
+
+    pool->slabs = (tetris_slab_t*)(start + skip);
+    pool->count = (int32_t)count;
+    pool->used = 0;
+
+    // Boards are only fully initialized here, later they are cleared up to their playfield height
+    for (int32_t i = 0; i < pool->count; i++)
+    {
+        tetris_board_init(&pool->slabs[i].board);
+        pool->slabs[i].gen = 1;
+        pool->slabs[i].next = (i == pool->count - 1) ? -1 : i + 1;
+    }
+    pool->free = 0;
+
+    return TETRIS_SUCCESS;
+}
+
+// Hands out an initialized game with an empty board
+tetris_handle_t tetris_pool_alloc(tetris_pool_t* pool, int32_t seed)
+{
+    tetris_slab_t* slab;
+    int32_t idx;
+
+    if (!pool || pool->free < 0) {
+        return 0;
+    }
+
+    // Pop from free list
+    idx = pool->free;
+    slab = &pool->slabs[idx];
+    pool->free = slab->next;
+    pool->used++;
+
+    slab->next = TETRIS_POOL_USED;
+    tetris_init_game(&slab->game, &slab->board, seed);
+
+    return TETRIS_POOL_HANDLE(idx, slab->gen);
+}
+
+// Returns a game to the pool
+tetris_error_t tetris_pool_free(tetris_pool_t* pool, tetris_handle_t handle)
+{
+    if (!tetris_pool_get(pool, handle)) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    tetris_pool_release(pool, (int32_t)(uint32_t)handle);
+    pool->used--;
+
+    return TETRIS_SUCCESS;
+}
+
+// Looks up the game of a handle
+tetris_game_t* tetris_pool_get(const tetris_pool_t* pool, tetris_handle_t handle)
+{
+    uint32_t idx = (uint32_t)handle;
+    uint32_t gen = (uint32_t)(handle >> 32);
+
+    if (!pool || idx >= (uint32_t)pool->count) {
+        return 0;
+    }
+    if (pool->slabs[idx].gen != gen || pool->slabs[idx].next != TETRIS_POOL_USED) {
+        return 0;
+    }
+
+    return &pool->slabs[idx].game;
+}
+
+// Returns every game to the pool
+void tetris_pool_reset(tetris_pool_t* pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    // Walk backwards so the free list hands out slabs in order again
+    pool->free = -1;
+    for (int32_t i = pool->count - 1; i >= 0; i--)
+    {
+        if (pool->slabs[i].next == TETRIS_POOL_USED) {
+            tetris_pool_release(pool, i);
+        }
+        else
+        {
+            pool->slabs[i].next = pool->free;
+            pool->free = i;
+        }
+    }
+    pool->used = 0;
+}
+
+// Clears a slab's board and puts it at the front of the free list
+void tetris_pool_release(tetris_pool_t* pool, int32_t idx)
+{
+    tetris_slab_t* slab = &pool->slabs[idx];
+
+    // Journal belongs to the caller, don't clear it
+    slab->game.journal = 0;
+    tetris_reset(&slab->game);
+
+    // Old handles stop working, 0 is skipped so a handle is never 0
+    slab->gen++;
+    if (slab->gen == 0) {
+        slab->gen = 1;
+    }
+
+    slab->next = pool->free;
+    pool->free = idx;
+}
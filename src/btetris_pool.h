@@ -0,0 +1,78 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+
+#ifndef __TETRIS_POOL__
+#define __TETRIS_POOL__
+
+// Slabs and the boards inside them are aligned to a cache line
+#define TETRIS_POOL_ALIGN TETRIS_CACHE_LINE
+
+// Marks a slab that is handed out
+#define TETRIS_POOL_USED -2
+
+
+// --- Pool Structures --- //
+
+/*
+ * Handle to a game in a pool. Low 32 bits are the slab index, high 32 bits are the slab's generation.
+ * Freeing a game changes the generation, so old handles stop working. 0 is never a valid handle.
+ */
+typedef uint64_t tetris_handle_t;
+
+// Game and board pair, the board directly follows the game
+typedef struct tetris_slab
+{
+    _Alignas(TETRIS_POOL_ALIGN) tetris_game_t game;
+    _Alignas(TETRIS_POOL_ALIGN) tetris_board_t board;
+    uint32_t    gen;    // Generation, changed every time the slab is freed
+    int32_t     next;   // Next free slab, -1 at the end of the free list, TETRIS_POOL_USED while handed out
+} tetris_slab_t;
+
+typedef struct tetris_pool
+{
+    tetris_slab_t*  slabs;  // Slabs in the caller provided arena
+    int32_t         count;  // Number of slabs
+    int32_t         used;   // Number of slabs handed out
+    int32_t         free;   // First free slab, -1 if the pool is full
+} tetris_pool_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Calculates the arena size needed for a number of games, including alignment
+/// @param count Number of games
+/// @return Size in bytes
+size_t tetris_pool_arena_size(int32_t count);
+
+/// @brief Splits an arena into slabs, every board is initialized once here
+/// @param pool Pool object
+/// @param arena Memory for the slabs, must stay allocated while the pool is used
+/// @param size Size of arena in bytes
+/// @return Error code, TETRIS_ERROR_INVALID_INPUT if not even one slab fits
+tetris_error_t tetris_pool_init(tetris_pool_t* pool, void* arena, size_t size);
+
+/// @brief Hands out an initialized game with an empty board
+/// @param pool Pool object
+/// @param seed Seed for the game's built-in RNG
+/// @return Handle, 0 if the pool is full
+tetris_handle_t tetris_pool_alloc(tetris_pool_t* pool, int32_t seed);
+
+/// @brief Returns a game to the pool. Its board is cleared with `tetris_reset()`, which only clears rows that were used.
+/// @param pool Pool object
+/// @param handle Handle from `tetris_pool_alloc()`
+/// @return Error code, TETRIS_ERROR_INVALID_INPUT if the handle is stale
+tetris_error_t tetris_pool_free(tetris_pool_t* pool, tetris_handle_t handle);
+
+/// @brief Looks up the game of a handle. The game's board pointer points into the same slab.
+/// @param pool Pool object
+/// @param handle Handle from `tetris_pool_alloc()`
+/// @return Game object, NULL if the handle is stale
+tetris_game_t* tetris_pool_get(const tetris_pool_t* pool, tetris_handle_t handle);
+
+/// @brief Returns every game to the pool, every handle becomes stale
+/// @param pool Pool object
+void tetris_pool_reset(tetris_pool_t* pool);
+
+#endif
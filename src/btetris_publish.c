@@ -0,0 +1,154 @@
+#include <string.h>
+#include "btetris_publish.h"
+#include "btetris_control.h"
+
+
+// --- Function Declarations --- //
+
+/// @brief Copies a game into a frame, except for its sequence number
+/// @param frame Frame object
+/// @param game Game object, its ghost piece cache must be up to date
+/// @param rows Number of rows to copy, rows above them are left as they are
+void tetris_frame_fill(tetris_frame_t* frame, const tetris_game_t* game, int8_t rows);
+
+
+// --- Function Definitions --- //
+
+// Initializes a publication with an empty frame
+void tetris_pub_init(tetris_pub_t* pub)
+{
+    atomic_init(&pub->seq, 0);
+    pub->height = 0;
+
+    memset(&pub->frame, 0, sizeof(tetris_frame_t));
+    pub->frame.pf_height = -1;
+    for (int i = 0; i < 4; i++)
+    {
+        pub->frame.fpos[i] = (tetris_coord_t){-1, -1};
+        pub->frame.gpos[i] = (tetris_coord_t){-1, -1};
+    }
+}
+
+// Copies a game into the publication
+tetris_error_t tetris_publish(tetris_pub_t* pub, tetris_game_t* game)
+{
+    tetris_frame_t* frame = &pub->frame;
+    tetris_board_t* board;
+    uint32_t seq;
+    int8_t top;
+
+    // Error checking
+    if (!pub) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    board = game->board;
+    if (!board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+
+    // Ghost piece is calculated before the write starts, so readers retry for as short as possible
+    if (tetris_calcGhostCoords(game) != TETRIS_SUCCESS) {
+        memcpy(board->gc_pos, board->fpos, sizeof(board->fpos));
+    }
+
+    // Odd sequence marks the frame as being written, the fence keeps the frame stores after it
+    seq = atomic_load_explicit(&pub->seq, memory_order_relaxed);
+    atomic_store_explicit(&pub->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Only rows that are or were filled are copied
+    frame->seq = (seq >> 1) + 1;
+    top = (board->pf_height + 1 > pub->height) ? board->pf_height + 1 : pub->height;
+    tetris_frame_fill(frame, game, top);
+    pub->height = board->pf_height + 1;
+
+    atomic_store_explicit(&pub->seq, seq + 2, memory_order_release);
+
+    return TETRIS_SUCCESS;
+}
+
+// Copies a game into a frame
+tetris_error_t tetris_frame_copy(tetris_frame_t* frame, tetris_game_t* game)
+{
+    // Error checking
+    if (!frame) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (!game) {
+        return TETRIS_ERROR_NULL_GAME;
+    }
+    if (!game->board) {
+        return TETRIS_ERROR_NULL_BOARD;
+    }
+
+    if (tetris_calcGhostCoords(game) != TETRIS_SUCCESS) {
+        memcpy(game->board->gc_pos, game->board->fpos, sizeof(game->board->fpos));
+    }
+    tetris_frame_fill(frame, game, TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF);
+
+    return TETRIS_SUCCESS;
+}
+
+// Copies the last published frame
+tetris_error_t tetris_pub_read(const tetris_pub_t* pub, tetris_frame_t* frame)
+{
+    atomic_uint* seqp;
+    uint32_t seq;
+    int32_t tries = TETRIS_PUB_RETRIES;
+
+    // Error checking
+    if (!pub || !frame) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    seqp = (atomic_uint*)&pub->seq;
+
+    // Copy is only kept if no write started or finished while it was taken
+    while (tries > 0)
+    {
+        seq = atomic_load_explicit(seqp, memory_order_acquire);
+        if (seq & 1)
+        {
+            tries--;
+            continue;
+        }
+        memcpy(frame, &pub->frame, sizeof(tetris_frame_t));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(seqp, memory_order_relaxed) == seq) {
+            return TETRIS_SUCCESS;
+        }
+        tries--;
+    }
+
+    // Writer is stuck mid publish, or publishing faster than a frame can be copied
+    return TETRIS_ERROR_PUB_BUSY;
+}
+
+// Copies a game into a frame, except for its sequence number
+void tetris_frame_fill(tetris_frame_t* frame, const tetris_game_t* game, int8_t rows)
+{
+    const tetris_board_t* board = game->board;
+
+    frame->flags = (game->isStarted ? 1 : 0) | (game->isRunning ? 2 : 0) | (game->isGameover ? 4 : 0);
+    frame->fcol = board->fcol;
+    frame->level = game->level;
+    frame->lines = game->lines;
+    frame->combo = game->combo;
+    frame->score = game->score;
+    frame->tmicro = game->tmicro;
+    memcpy(frame->fpos, board->fpos, sizeof(board->fpos));
+    memcpy(frame->gpos, board->gc_pos, sizeof(board->gc_pos));
+    for (int k = 0; k < TETRIS_PP_SIZE; k++) {
+        frame->ppreview[k] = (int8_t)tetris_ppreview_peek(game, k);
+    }
+
+    for (int8_t h = 0; h < rows; h++)
+    {
+        for (int w = 0; w < TETRIS_WIDTH; w++) {
+            frame->pf[h][w] = (uint8_t)TETRIS_PF(board, h, w);
+        }
+    }
+    frame->pf_height = board->pf_height;
+}
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdatomic.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+
+#ifndef __TETRIS_PUBLISH__
+#define __TETRIS_PUBLISH__
+
+// Times `tetris_pub_read()` checks the sequence counter before giving up, so a writer that died mid publish can't hang readers
+#ifndef TETRIS_PUB_RETRIES
+    #define TETRIS_PUB_RETRIES 65536
+#elif TETRIS_PUB_RETRIES < 1
+    #error invalid read retry count, too small
+#elif TETRIS_PUB_RETRIES > 2147483647
+    #error invalid read retry count, too large
+#endif
+
+
+// --- Publish Structures --- //
+
+// Render-ready copy of a game, everything a frontend draws without access to the game itself
+typedef struct tetris_frame
+{
+    uint32_t        seq;        // Number of frames published, including this one
+    int8_t          flags;      // Bit 0 isStarted, bit 1 isRunning, bit 2 isGameover
+    int8_t          pf_height;  // Index of highest row that can be filled, same as the board's. -1 before the first publish
+    int8_t          fcol;       // Falling tetromino color, TETRIS_BLANK if none
+    int8_t          level;
+    int8_t          lines;      // Lines cleared in this level
+    int8_t          combo;
+    tetris_coord_t  fpos[4];    // Falling tetromino
+    tetris_coord_t  gpos[4];    // Ghost piece, same as fpos if there is no falling tetromino
+    int8_t          ppreview[TETRIS_PP_SIZE];   // Piece preview, next tetromino first
+    int64_t         score;
+    int64_t         tmicro;     // Game time
+
+    // Locked cells as tetris_color_t, one byte each. Rows above pf_height are empty.
+    uint8_t         pf[TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF][TETRIS_WIDTH];
+} tetris_frame_t;
+
+/*
+ * Single writer publication of frames, protected by a sequence lock. Can be placed in memory shared between processes.
+ * The writer makes `seq` odd while it copies a frame and even again after, it never waits for readers.
+ * Readers copy the frame and retry if `seq` was odd or changed during the copy, so they never block the writer either.
+ */
+typedef struct tetris_pub
+{
+    _Alignas(TETRIS_CACHE_LINE) atomic_uint seq;    // Even when no write is in progress
+    int8_t                                  height; // Rows written by the last publish, only used by the writer
+    _Alignas(TETRIS_CACHE_LINE) tetris_frame_t frame;
+} tetris_pub_t;
+
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "tetris_pub_t needs a lock-free sequence counter to be shared between processes");
+
+
+// --- Function Declarations --- //
+
+/// @brief Initializes a publication with an empty frame. Call before any reader maps it.
+/// @param pub Publication object
+void tetris_pub_init(tetris_pub_t* pub);
+
+/// @brief Copies a game into the publication, meant to be called after every tick. Never blocks.
+/// @param pub Publication object, only one thread may publish into it
+/// @param game Game object, its ghost piece cache is updated
+/// @return Error code
+tetris_error_t tetris_publish(tetris_pub_t* pub, tetris_game_t* game);
+
+/// @brief Copies a game into a plain frame, for handing snapshots between threads of one process. Leaves seq as it is.
+/// @param frame Frame to copy into
+/// @param game Game object, its ghost piece cache is updated
+/// @return Error code
+tetris_error_t tetris_frame_copy(tetris_frame_t* frame, tetris_game_t* game);
+
+/// @brief Copies the last published frame. Retries while a publish is in progress, without locking or syscalls.
+/// @param pub Publication object
+/// @param frame Frame to copy into, its contents are undefined if the read fails
+/// @return TETRIS_ERROR_PUB_BUSY if a publish was in progress for all TETRIS_PUB_RETRIES checks, the caller should back off and retry
+tetris_error_t tetris_pub_read(const tetris_pub_t* pub, tetris_frame_t* frame);
+
+/// @brief Gets the number of frames published so far, a reader can skip copying when it hasn't changed
+/// @param pub Publication object
+/// @return Frame count
+static inline uint32_t tetris_pub_count(const tetris_pub_t* pub);
+
+
+// Gets the number of frames published so far
+static inline uint32_t tetris_pub_count(const tetris_pub_t* pub)
+{
+    return atomic_load_explicit((atomic_uint*)&pub->seq, memory_order_acquire) >> 1;
+}
+
+#endif
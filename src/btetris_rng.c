@@ -0,0 +1,102 @@
+#include "btetris_rng.h"
+
+// Rotates bits to the left
+#define ROTL32(val, k) (((val) << (k)) | ((val) >> (32 - (k))))
+
+// Seeds a generator
+void tetris_rng_seed(tetris_rng_t* rng, uint64_t seed)
+{
+    uint64_t x;
+
+    // Expand seed with splitmix64 so similar seeds give unrelated states
+    seed = tetris_rng_mix64(seed);
+    x = tetris_rng_mix64(seed);
+    rng->s[0] = (uint32_t)seed;
+    rng->s[1] = (uint32_t)(seed >> 32);
+    rng->s[2] = (uint32_t)x;
+    rng->s[3] = (uint32_t)(x >> 32);
+
+    // All zero state would only ever generate zeros
+    if (!(rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3])) {
+        rng->s[0] = 1;
+    }
+}
+
+// Generates the next 32 random bits
+uint32_t tetris_rng_next(tetris_rng_t* rng)
+{
+    uint32_t* s = rng->s;
+    uint32_t result, t;
+
+    result = ROTL32(s[1] * 5, 7) * 9;
+    t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+
+    s[2] ^= t;
+    s[3] = ROTL32(s[3], 11);
+
+    return result;
+}
+
+// Advances the generator by 2^64 calls of next()
+void tetris_rng_jump(tetris_rng_t* rng)
+{
+    static const uint32_t JUMP[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+
+    uint32_t s0 = 0;
+    uint32_t s1 = 0;
+    uint32_t s2 = 0;
+    uint32_t s3 = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int b = 0; b < 32; b++)
+        {
+            if (JUMP[i] & (UINT32_C(1) << b))
+            {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            tetris_rng_next(rng);
+        }
+    }
+
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+// Gives child a stream independent of the master
+void tetris_rng_split(tetris_rng_t* master, tetris_rng_t* child)
+{
+    *child = *master;
+    tetris_rng_jump(master);
+}
+
+// Mixes entropy into the generator state
+void tetris_rng_entropy(tetris_rng_t* rng, uint32_t entropy)
+{
+    rng->s[0] ^= entropy;
+    rng->s[2] ^= ROTL32(entropy, 16);
+
+    // Entropy might have zeroed the state
+    if (!(rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3])) {
+        rng->s[0] = 1;
+    }
+}
+
+// Mixes a 64 bit integer (splitmix64)
+uint64_t tetris_rng_mix64(uint64_t x)
+{
+    x += UINT64_C(0x9e3779b97f4a7c15);
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
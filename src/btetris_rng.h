@@ -0,0 +1,53 @@
+#include <stdint.h>
+
+#ifndef __TETRIS_RNG__
+#define __TETRIS_RNG__
+
+// https://prng.di.unimi.it/
+
+// --- RNG Structures --- //
+
+/// @brief Custom random function, can be used in place of the built-in generator
+/// @param state State pointer given to `tetris_rand_setfunc()`
+/// @return 32 random bits
+typedef uint32_t (*tetris_randfunc_t)(void* state);
+
+// Built-in generator state (xoshiro128**). State must never be all zeros.
+typedef struct tetris_rng {
+    uint32_t s[4];
+} tetris_rng_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Seeds a generator. Every seed produces a valid state.
+/// @param rng Generator state
+/// @param seed Any integer
+void tetris_rng_seed(tetris_rng_t* rng, uint64_t seed);
+
+/// @brief Generates the next 32 random bits
+/// @param rng Generator state
+/// @return Random number
+uint32_t tetris_rng_next(tetris_rng_t* rng);
+
+/// @brief Advances the generator by 2^64 calls of `tetris_rng_next()`
+/// @param rng Generator state
+void tetris_rng_jump(tetris_rng_t* rng);
+
+/// @brief Gives child a stream independent of the master and every previously split stream.
+/// Child gets a copy of the master, then the master jumps ahead by 2^64.
+/// @param master Generator state that all streams are split from
+/// @param child Generator state to initialize
+void tetris_rng_split(tetris_rng_t* master, tetris_rng_t* child);
+
+/// @brief Mixes entropy into the generator state
+/// @param rng Generator state
+/// @param entropy Any integer
+void tetris_rng_entropy(tetris_rng_t* rng, uint32_t entropy);
+
+/// @brief Mixes a 64 bit integer. Useful for deriving seeds from counters.
+/// @param x Value to mix
+/// @return Mixed value
+uint64_t tetris_rng_mix64(uint64_t x);
+
+#endif
@@ -0,0 +1,197 @@
+#include <string.h>
+#include "btetris_rollback.h"
+
+// Input buffer slot of a frame
+#define TETRIS_ROLLBACK_SLOT(frame) ((frame) % (2*TETRIS_ROLLBACK_FRAMES))
+
+
+// --- Function Declarations --- //
+
+/// @brief Saves a snapshot of the frame, then applies the frame's inputs and ticks the match
+/// @param session Session object
+/// @param frame Frame to simulate
+void tetris_rollback_simulate(tetris_rollback_t* session, int32_t frame);
+
+
+// --- Function Definitions --- //
+
+// Starts a session
+tetris_error_t tetris_rollback_init(tetris_rollback_t* session, int8_t count, int8_t local, uint64_t seed)
+{
+    tetris_game_t* games[TETRIS_VERSUS_PLAYERS];
+
+    // Error checking
+    if (!session) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (count < 2 || count > TETRIS_VERSUS_PLAYERS || local < 0 || local >= count) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    // Every peer derives the same games from the seed
+    for (int i = 0; i < count; i++)
+    {
+        tetris_init(&session->games[i], &session->boards[i], (int32_t)tetris_rng_mix64(seed + i));
+        tetris_start(&session->games[i]);
+        games[i] = &session->games[i];
+    }
+    tetris_versus_init(&session->match, games, count, seed);
+
+    session->count = count;
+    session->local = local;
+    session->frame = 0;
+    session->rollto = 0;
+
+    memset(session->inputs, 0, sizeof(session->inputs));
+    memset(session->known, 0, sizeof(session->known));
+    for (int i = 0; i < TETRIS_VERSUS_PLAYERS; i++) {
+        session->confirmed[i] = -1;
+    }
+
+    session->rollbacks = 0;
+    session->resims = 0;
+
+    return TETRIS_SUCCESS;
+}
+
+// Simulates the next frame with the local player's input
+tetris_error_t tetris_rollback_advance(tetris_rollback_t* session, tetris_input_t input)
+{
+    tetris_snapshot_t* snap;
+    int32_t frame;
+    int slot;
+
+    if (!session) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    frame = session->frame;
+
+    // Go back to the first mispredicted frame and simulate up to the current one again
+    if (session->rollto < frame)
+    {
+        snap = &session->snapshots[session->rollto % TETRIS_ROLLBACK_FRAMES];
+        memcpy(session->games, snap->games, session->count * sizeof(tetris_game_t));
+        memcpy(session->boards, snap->boards, session->count * sizeof(tetris_board_t));
+        session->match = snap->match;
+
+        session->rollbacks++;
+        session->resims += frame - session->rollto;
+        for (int32_t f = session->rollto; f < frame; f++) {
+            tetris_rollback_simulate(session, f);
+        }
+        session->rollto = frame;
+    }
+
+    // Snapshot of the oldest frame that can still change is overwritten by this frame
+    if (tetris_rollback_confirmed(session) < frame - TETRIS_ROLLBACK_FRAMES) {
+        return TETRIS_ERROR_ROLLBACK_STALL;
+    }
+
+    slot = TETRIS_ROLLBACK_SLOT(frame);
+    session->inputs[slot][session->local] = input;
+    session->known[slot] |= (uint64_t)1 << session->local;
+    session->confirmed[session->local] = frame;
+
+    tetris_rollback_simulate(session, frame);
+    session->frame = frame + 1;
+    session->rollto = frame + 1;
+
+    // Slot of the frame that just moved out of the window is reused for inputs ahead of it
+    slot = TETRIS_ROLLBACK_SLOT(frame + TETRIS_ROLLBACK_FRAMES);
+    if (frame >= TETRIS_ROLLBACK_FRAMES)
+    {
+        memset(session->inputs[slot], 0, sizeof(session->inputs[slot]));
+        session->known[slot] = 0;
+    }
+
+    return (session->match.alive > 1) ? TETRIS_SUCCESS : TETRIS_ERROR_GAME_OVER;
+}
+
+// Adds the input of a remote player
+tetris_error_t tetris_rollback_remote(tetris_rollback_t* session, int8_t player, int32_t frame, tetris_input_t input)
+{
+    int slot;
+
+    // Error checking
+    if (!session || player < 0 || player >= session->count || player == session->local || frame < 0) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (frame >= session->frame + TETRIS_ROLLBACK_FRAMES) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    // Frames before the window are already known
+    if (frame <= session->confirmed[player]) {
+        return TETRIS_SUCCESS;
+    }
+
+    slot = TETRIS_ROLLBACK_SLOT(frame);
+
+    // Frame was simulated with a different prediction
+    if (frame < session->rollto && session->inputs[slot][player] != input) {
+        session->rollto = frame;
+    }
+
+    session->inputs[slot][player] = input;
+    session->known[slot] |= (uint64_t)1 << player;
+
+    // Move the confirmed frame past every input that arrived in order
+    while (session->confirmed[player] + 1 < session->frame + TETRIS_ROLLBACK_FRAMES &&
+           (session->known[TETRIS_ROLLBACK_SLOT(session->confirmed[player] + 1)] >> player) & 1)
+    {
+        session->confirmed[player]++;
+    }
+
+    return TETRIS_SUCCESS;
+}
+
+// Finds the last frame whose inputs are known for every player
+int32_t tetris_rollback_confirmed(const tetris_rollback_t* session)
+{
+    int32_t confirmed;
+
+    if (!session) {
+        return -1;
+    }
+
+    confirmed = session->frame - 1;
+    for (int i = 0; i < session->count; i++)
+    {
+        if (confirmed > session->confirmed[i]) {
+            confirmed = session->confirmed[i];
+        }
+    }
+
+    return confirmed;
+}
+
+// Saves a snapshot of the frame, then applies the frame's inputs and ticks the match
+void tetris_rollback_simulate(tetris_rollback_t* session, int32_t frame)
+{
+    tetris_snapshot_t* snap = &session->snapshots[frame % TETRIS_ROLLBACK_FRAMES];
+    tetris_input_t* inputs = session->inputs[TETRIS_ROLLBACK_SLOT(frame)];
+    tetris_cmd_t cmds[TETRIS_CMD_HDROP + 1];
+    int n;
+
+    memcpy(snap->games, session->games, session->count * sizeof(tetris_game_t));
+    memcpy(snap->boards, session->boards, session->count * sizeof(tetris_board_t));
+    snap->match = session->match;
+
+    for (int i = 0; i < session->count; i++)
+    {
+        if (!inputs[i] || !session->match.players[i].alive) {
+            continue;
+        }
+
+        n = 0;
+        for (int c = TETRIS_CMD_LEFT; c <= TETRIS_CMD_HDROP; c++)
+        {
+            if (inputs[i] & TETRIS_INPUT(c)) {
+                cmds[n++] = c;
+            }
+        }
+        tetris_apply_inputs(&session->games[i], cmds, n, NULL);
+    }
+
+    tetris_versus_tick(&session->match, TETRIS_ROLLBACK_TICK);
+}
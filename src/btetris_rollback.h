@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+#include "btetris_control.h"
+#include "btetris_versus.h"
+
+#ifndef __TETRIS_ROLLBACK__
+#define __TETRIS_ROLLBACK__
+
+// Number of frames that can be rolled back, a session stalls when a remote player is this many frames behind
+#ifndef TETRIS_ROLLBACK_FRAMES
+    #define TETRIS_ROLLBACK_FRAMES 8
+#elif TETRIS_ROLLBACK_FRAMES < 1
+    #error invalid rollback window, too small
+#elif TETRIS_ROLLBACK_FRAMES > 64
+    #error invalid rollback window, too large
+#endif
+
+// Microseconds simulated per frame
+#ifndef TETRIS_ROLLBACK_TICK
+    #define TETRIS_ROLLBACK_TICK 16667
+#endif
+
+// Input of one player for one frame, a set of tetris_cmd_t bits
+typedef uint8_t tetris_input_t;
+
+// Bit of a command in tetris_input_t, commands are applied in the order of tetris_cmd_t
+#define TETRIS_INPUT(cmd) ((tetris_input_t)(1 << (cmd)))
+
+
+// --- Rollback Structures --- //
+
+// State of every player at the start of a frame
+typedef struct tetris_snapshot
+{
+    tetris_game_t   games[TETRIS_VERSUS_PLAYERS];
+    tetris_board_t  boards[TETRIS_VERSUS_PLAYERS];
+    tetris_versus_t match;
+} tetris_snapshot_t;
+
+/*
+ * Lockstep versus session with rollback. Every peer runs the same session with the same seed.
+ * Frames are simulated as soon as the local input is known, missing remote inputs are predicted to be empty.
+ * When a remote input arrives that doesn't match the prediction, the session restores the snapshot of that frame
+ * and simulates the frames after it again on the next `tetris_rollback_advance()`.
+ * Games and the match are stored inside the session, it must not be moved after `tetris_rollback_init()`.
+ */
+typedef struct tetris_rollback
+{
+    // Simulated state
+    tetris_game_t   games[TETRIS_VERSUS_PLAYERS];
+    tetris_board_t  boards[TETRIS_VERSUS_PLAYERS];
+    tetris_versus_t match;
+
+    int8_t  count;      // Number of players
+    int8_t  local;      // Index of the local player
+    int32_t frame;      // Next frame to simulate
+    int32_t rollto;     // First frame to simulate again, equal to frame if nothing has to be rolled back
+
+    // Inputs, indexed by frame modulo 2*TETRIS_ROLLBACK_FRAMES, frames up to TETRIS_ROLLBACK_FRAMES ahead are buffered
+    tetris_input_t  inputs[2*TETRIS_ROLLBACK_FRAMES][TETRIS_VERSUS_PLAYERS];
+    uint64_t        known[2*TETRIS_ROLLBACK_FRAMES];    // Bit set for every player whose input of the frame arrived
+    int32_t         confirmed[TETRIS_VERSUS_PLAYERS];   // Last frame every earlier input of a player arrived for
+
+    // State at the start of each of the last TETRIS_ROLLBACK_FRAMES frames, indexed by frame modulo TETRIS_ROLLBACK_FRAMES
+    tetris_snapshot_t snapshots[TETRIS_ROLLBACK_FRAMES];
+
+    // Statistics
+    int32_t rollbacks;  // Number of rollbacks
+    int32_t resims;     // Number of frames simulated again
+} tetris_rollback_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Starts a session, every peer must use the same player count and seed
+/// @param session Session object
+/// @param count Number of players, [2:TETRIS_VERSUS_PLAYERS]
+/// @param local Index of the local player
+/// @param seed Seed for the games and garbage holes
+/// @return Error code
+tetris_error_t tetris_rollback_init(tetris_rollback_t* session, int8_t count, int8_t local, uint64_t seed);
+
+/// @brief Simulates the next frame with the local player's input. Pending rollbacks are simulated first.
+/// @param session Session object
+/// @param input Input of the local player for this frame
+/// @return TETRIS_ERROR_ROLLBACK_STALL if a remote player is too far behind, the frame isn't simulated and the input is dropped.
+/// TETRIS_ERROR_GAME_OVER once the match is over.
+tetris_error_t tetris_rollback_advance(tetris_rollback_t* session, tetris_input_t input);
+
+/// @brief Adds the input of a remote player, inputs can arrive in any order
+/// @param session Session object
+/// @param player Index of the remote player
+/// @param frame Frame of the input
+/// @param input Input of the player for the frame
+/// @return TETRIS_ERROR_INVALID_INPUT if the frame is too far ahead to buffer
+tetris_error_t tetris_rollback_remote(tetris_rollback_t* session, int8_t player, int32_t frame, tetris_input_t input);
+
+/// @brief Finds the last frame whose inputs are known for every player, state up to it can't be rolled back anymore
+/// @param session Session object
+/// @return Frame number, -1 if none
+int32_t tetris_rollback_confirmed(const tetris_rollback_t* session);
+
+#endif
@@ -0,0 +1,475 @@
+#include <string.h>
+#include "btetris_stream.h"
+
+// Row byte bit set when every filled cell's color follows, not only the newly filled ones
+#define TETRIS_STREAM_FULL 0x80
+
+
+// --- Function Declarations --- //
+
+/// @brief Applies an encoded frame to a decoder state, see `tetris_stream_decode()`
+/// @param state State object
+/// @param buf Encoded frame
+/// @param len Length of the frame in bytes
+/// @return Error code
+tetris_error_t tetris_stream_apply(tetris_stream_state_t* state, const uint8_t* buf, int32_t len);
+
+/// @brief Writes an unsigned varint, 7 bits per byte with the top bit set on every byte but the last
+/// @param buf Output buffer
+/// @param x Value
+/// @return Number of bytes written
+int tetris_stream_putvar(uint8_t* buf, uint64_t x);
+
+/// @brief Reads an unsigned varint
+/// @param buf Input buffer
+/// @param len Bytes left in the buffer
+/// @param x Value read
+/// @return Number of bytes read, 0 if the varint is truncated or too long
+int tetris_stream_getvar(const uint8_t* buf, int32_t len, uint64_t* x);
+
+/// @brief Encodes a row that differs from the sent state and copies it into the sent state
+/// @param stream Stream object
+/// @param board Board of the game
+/// @param h Row
+/// @param buf Output buffer
+/// @return Number of bytes written
+int tetris_stream_putrow(tetris_stream_t* stream, const tetris_board_t* board, int8_t h, uint8_t* buf);
+
+/// @brief Decodes a row record into a state
+/// @param state State object
+/// @param buf Input buffer, starting at the row byte
+/// @param len Bytes left in the buffer
+/// @return Number of bytes read, 0 if the record is malformed
+int tetris_stream_getrow(tetris_stream_state_t* state, const uint8_t* buf, int32_t len);
+
+
+// --- Function Definitions --- //
+
+// Initializes an encoder
+void tetris_stream_init(tetris_stream_t* stream, int32_t keyint)
+{
+    tetris_stream_state_init(&stream->sent);
+    stream->frame = 0;
+    stream->keyint = (keyint > 0) ? keyint : TETRIS_STREAM_KEYINT;
+    stream->nextkey = 0;
+}
+
+// Makes the next encoded frame a keyframe
+void tetris_stream_keyframe(tetris_stream_t* stream)
+{
+    stream->nextkey = stream->frame;
+}
+
+// Encodes the changes of a game since the last frame
+int32_t tetris_stream_encode(tetris_stream_t* stream, const tetris_game_t* game, uint8_t* buf)
+{
+    tetris_stream_state_t* sent = &stream->sent;
+    const tetris_board_t* board = game->board;
+    uint8_t sect = 0;
+    int32_t p = 1;
+    int32_t rows = 0;
+    int8_t flags, dh, dw, top, height, n;
+    int8_t ppreview[TETRIS_PP_SIZE];
+    uint64_t delta;
+
+    // A keyframe is a diff against an empty state
+    if (stream->frame++ >= stream->nextkey)
+    {
+        tetris_stream_state_init(sent);
+        sent->valid = 1;
+        stream->nextkey = stream->frame - 1 + stream->keyint;
+        sect = TETRIS_STREAM_KEY | TETRIS_STREAM_FLAGS | TETRIS_STREAM_PIECE | TETRIS_STREAM_QUEUE | TETRIS_STREAM_SCORE;
+    }
+
+    // Game state flags
+    flags = (game->isStarted ? 1 : 0) | (game->isRunning ? 2 : 0) | (game->isGameover ? 4 : 0);
+    if ((sect & TETRIS_STREAM_FLAGS) || flags != sent->flags)
+    {
+        sect |= TETRIS_STREAM_FLAGS;
+        buf[p++] = flags;
+        sent->flags = flags;
+    }
+
+    // Falling tetromino, a move is sent as one byte when every block moved by the same small offset
+    if (!(sect & TETRIS_STREAM_PIECE) && board->fcol == sent->board.fcol && board->frot == sent->board.frot)
+    {
+        dh = board->fpos[0].h - sent->board.fpos[0].h;
+        dw = board->fpos[0].w - sent->board.fpos[0].w;
+
+        for (int i = 1; i < 4; i++)
+        {
+            if (board->fpos[i].h - sent->board.fpos[i].h != dh || board->fpos[i].w - sent->board.fpos[i].w != dw) {
+                sect |= TETRIS_STREAM_PIECE;
+            }
+        }
+        if (dh < -8 || dh > 7 || dw < -8 || dw > 7) {
+            sect |= TETRIS_STREAM_PIECE;
+        }
+
+        if (!(sect & TETRIS_STREAM_PIECE) && (dh || dw))
+        {
+            sect |= TETRIS_STREAM_MOVE;
+            buf[p++] = (uint8_t)((dh & 0xF) << 4 | (dw & 0xF));
+        }
+    }
+    else {
+        sect |= TETRIS_STREAM_PIECE;
+    }
+
+    if (sect & TETRIS_STREAM_PIECE)
+    {
+        buf[p++] = (uint8_t)board->fcol;
+        buf[p++] = (uint8_t)board->frot;
+        for (int i = 0; i < 4; i++)
+        {
+            buf[p++] = (uint8_t)board->fpos[i].h;
+            buf[p++] = (uint8_t)board->fpos[i].w;
+        }
+    }
+    sent->board.fcol = board->fcol;
+    sent->board.frot = board->frot;
+    memcpy(sent->board.fpos, board->fpos, sizeof(board->fpos));
+
+    // Piece preview, changes once per spawned tetromino
+    for (int k = 0; k < TETRIS_PP_SIZE; k++) {
+        ppreview[k] = (int8_t)tetris_ppreview_peek(game, k);
+    }
+    if ((sect & TETRIS_STREAM_QUEUE) || memcmp(ppreview, sent->ppreview, sizeof(ppreview)))
+    {
+        sect |= TETRIS_STREAM_QUEUE;
+        for (int k = 0; k < TETRIS_PP_SIZE; k += 2) {
+            buf[p++] = (uint8_t)(ppreview[k] | ((k + 1 < TETRIS_PP_SIZE) ? ppreview[k+1] << 4 : 0));
+        }
+        memcpy(sent->ppreview, ppreview, sizeof(ppreview));
+    }
+
+    // Score as a zigzag encoded change
+    if ((sect & TETRIS_STREAM_SCORE) || game->score != sent->score || game->level != sent->level || game->lines != sent->lines)
+    {
+        sect |= TETRIS_STREAM_SCORE;
+        buf[p++] = (uint8_t)game->level;
+        buf[p++] = (uint8_t)game->lines;
+        delta = (uint64_t)game->score - (uint64_t)sent->score;
+        p += tetris_stream_putvar(&buf[p], (delta << 1) ^ (uint64_t)((int64_t)delta >> 63));
+
+        sent->score = game->score;
+        sent->level = game->level;
+        sent->lines = game->lines;
+    }
+
+    // Rows above both the playfield height and the sent height are empty on both sides
+    top = (board->pf_height > sent->height - 1) ? board->pf_height : sent->height - 1;
+    height = 0;
+    n = 0;
+    for (int8_t h = 0; h <= top; h++)
+    {
+        if (memcmp(&TETRIS_PF(board, h, 0), &TETRIS_PF(&sent->board, h, 0), TETRIS_WIDTH*sizeof(tetris_color_t)))
+        {
+            if (!n++)
+            {
+                sect |= TETRIS_STREAM_ROWS;
+                rows = p++;
+            }
+            p += tetris_stream_putrow(stream, board, h, &buf[p]);
+        }
+        if (board->rowcnt[h]) {
+            height = h + 1;
+        }
+    }
+    if (n) {
+        buf[rows] = (uint8_t)n;
+    }
+    sent->height = height;
+
+    if (!sect) {
+        return 0;
+    }
+    buf[0] = sect;
+
+    return p;
+}
+
+// Initializes a decoder state
+void tetris_stream_state_init(tetris_stream_state_t* state)
+{
+    tetris_board_init(&state->board);
+    memset(state->ppreview, 0, sizeof(state->ppreview));
+    state->score = 0;
+    state->level = 0;
+    state->lines = 0;
+    state->flags = 0;
+    state->height = 0;
+    state->valid = 0;
+}
+
+// Applies an encoded frame to a decoder state
+tetris_error_t tetris_stream_decode(tetris_stream_state_t* state, const uint8_t* buf, int32_t len)
+{
+    tetris_error_t err;
+
+    if (!state) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    // A partly applied frame leaves the state inconsistent, wait for the next keyframe
+    err = tetris_stream_apply(state, buf, len);
+    if (err == TETRIS_ERROR_INVALID_INPUT) {
+        state->valid = 0;
+    }
+
+    return err;
+}
+
+// Applies an encoded frame to a decoder state
+tetris_error_t tetris_stream_apply(tetris_stream_state_t* state, const uint8_t* buf, int32_t len)
+{
+    uint8_t sect;
+    int32_t p = 1;
+    int8_t dh, dw, n, height;
+    uint64_t delta;
+    int k;
+
+    // Error checking
+    if (!buf || len < 1) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    sect = buf[0];
+    if (sect & ~0x7F) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    if (sect & TETRIS_STREAM_KEY)
+    {
+        tetris_stream_state_init(state);
+        state->valid = 1;
+    }
+    if (!state->valid) {
+        return TETRIS_ERROR_NOT_STARTED;
+    }
+
+    if (sect & TETRIS_STREAM_FLAGS)
+    {
+        if (p + 1 > len) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        state->flags = buf[p++];
+    }
+
+    if (sect & TETRIS_STREAM_MOVE)
+    {
+        if (p + 1 > len) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+
+        // Sign extend both nibbles
+        dh = (int8_t)((int8_t)buf[p] >> 4);
+        dw = (int8_t)((int8_t)(buf[p] << 4) >> 4);
+        p++;
+        for (int i = 0; i < 4; i++)
+        {
+            state->board.fpos[i].h += dh;
+            state->board.fpos[i].w += dw;
+        }
+    }
+
+    if (sect & TETRIS_STREAM_PIECE)
+    {
+        if (p + 10 > len || buf[p] > TETRIS_RED || buf[p+1] > 3) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        state->board.fcol = buf[p++];
+        state->board.frot = buf[p++];
+        for (int i = 0; i < 4; i++)
+        {
+            state->board.fpos[i].h = (int8_t)buf[p++];
+            state->board.fpos[i].w = (int8_t)buf[p++];
+        }
+    }
+    state->board.gc_valid = 0;
+
+    if (sect & TETRIS_STREAM_QUEUE)
+    {
+        if (p + (TETRIS_PP_SIZE + 1) / 2 > len) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        for (k = 0; k < TETRIS_PP_SIZE; k++) {
+            state->ppreview[k] = (buf[p + k/2] >> ((k & 1) * 4)) & 0xF;
+        }
+        p += (TETRIS_PP_SIZE + 1) / 2;
+    }
+
+    if (sect & TETRIS_STREAM_SCORE)
+    {
+        if (p + 2 > len) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        state->level = (int8_t)buf[p++];
+        state->lines = (int8_t)buf[p++];
+
+        k = tetris_stream_getvar(&buf[p], len - p, &delta);
+        if (!k) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        p += k;
+        state->score = (int64_t)((uint64_t)state->score + ((delta >> 1) ^ (0 - (delta & 1))));
+    }
+
+    if (sect & TETRIS_STREAM_ROWS)
+    {
+        if (p + 1 > len) {
+            return TETRIS_ERROR_INVALID_INPUT;
+        }
+        n = (int8_t)buf[p++];
+        for (int i = 0; i < n; i++)
+        {
+            k = tetris_stream_getrow(state, &buf[p], len - p);
+            if (!k) {
+                return TETRIS_ERROR_INVALID_INPUT;
+            }
+            p += k;
+        }
+
+        height = state->height;
+        while (height > 0 && !state->board.rowcnt[height - 1]) {
+            height--;
+        }
+        state->height = height;
+        state->board.pf_height = height - 1;
+    }
+
+    return (p == len) ? TETRIS_SUCCESS : TETRIS_ERROR_INVALID_INPUT;
+}
+
+// Writes an unsigned varint
+int tetris_stream_putvar(uint8_t* buf, uint64_t x)
+{
+    int n = 0;
+
+    while (x >= 0x80)
+    {
+        buf[n++] = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    buf[n++] = (uint8_t)x;
+
+    return n;
+}
+
+// Reads an unsigned varint
+int tetris_stream_getvar(const uint8_t* buf, int32_t len, uint64_t* x)
+{
+    *x = 0;
+    for (int n = 0; n < len && n < 10; n++)
+    {
+        *x |= (uint64_t)(buf[n] & 0x7F) << (7*n);
+        if (!(buf[n] & 0x80)) {
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+// Encodes a row that differs from the sent state
+int tetris_stream_putrow(tetris_stream_t* stream, const tetris_board_t* board, int8_t h, uint8_t* buf)
+{
+    tetris_board_t* sent = &stream->sent.board;
+    uint8_t mask[TETRIS_STREAM_MASK] = {0};
+    int8_t full = 0;
+    int p, nib = 0;
+    tetris_color_t old, col;
+
+    for (int w = 0; w < TETRIS_WIDTH; w++)
+    {
+        old = TETRIS_PF(sent, h, w);
+        col = TETRIS_PF(board, h, w);
+
+        if ((old != TETRIS_BLANK) != (col != TETRIS_BLANK)) {
+            mask[w >> 3] |= 1 << (w & 7);
+        }
+        else if (old != col) {
+            full = 1;
+        }
+    }
+
+    buf[0] = (uint8_t)h | (full ? TETRIS_STREAM_FULL : 0);
+    memcpy(&buf[1], mask, TETRIS_STREAM_MASK);
+    p = 1 + TETRIS_STREAM_MASK;
+
+    // Colors two per byte, low nibble first
+    for (int w = 0; w < TETRIS_WIDTH; w++)
+    {
+        col = TETRIS_PF(board, h, w);
+        if (col != TETRIS_BLANK && (full || TETRIS_PF(sent, h, w) == TETRIS_BLANK))
+        {
+            if (nib & 1) {
+                buf[p++] |= (uint8_t)(col << 4);
+            }
+            else {
+                buf[p] = (uint8_t)col;
+            }
+            nib++;
+        }
+    }
+    if (nib & 1) {
+        p++;
+    }
+
+    memcpy(&TETRIS_PF(sent, h, 0), &TETRIS_PF(board, h, 0), TETRIS_WIDTH*sizeof(tetris_color_t));
+    sent->rowcnt[h] = board->rowcnt[h];
+
+    return p;
+}
+
+// Decodes a row record into a state
+int tetris_stream_getrow(tetris_stream_state_t* state, const uint8_t* buf, int32_t len)
+{
+    tetris_board_t* board = &state->board;
+    const uint8_t* mask = &buf[1];
+    int8_t h, full, filled;
+    int p, nib = 0, cnt = 0;
+    tetris_color_t col;
+
+    if (len < 1 + TETRIS_STREAM_MASK) {
+        return 0;
+    }
+    h = buf[0] & ~TETRIS_STREAM_FULL;
+    full = (buf[0] & TETRIS_STREAM_FULL) != 0;
+    if (h >= TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF) {
+        return 0;
+    }
+    p = 1 + TETRIS_STREAM_MASK;
+
+    for (int w = 0; w < TETRIS_WIDTH; w++)
+    {
+        col = TETRIS_PF(board, h, w);
+        filled = (col != TETRIS_BLANK) ^ ((mask[w >> 3] >> (w & 7)) & 1);
+
+        // Read the next color if this cell's color was sent
+        if (filled && (full || col == TETRIS_BLANK))
+        {
+            if (p + (nib >> 1) >= len) {
+                return 0;
+            }
+            col = (buf[p + (nib >> 1)] >> ((nib & 1) * 4)) & 0xF;
+            if (col == TETRIS_BLANK || col == TETRIS_WALL || col > TETRIS_GARBAGE) {
+                return 0;
+            }
+            nib++;
+        }
+        else if (!filled) {
+            col = TETRIS_BLANK;
+        }
+
+        TETRIS_PF(board, h, w) = col;
+        cnt += filled;
+    }
+
+    board->cellcnt += cnt - board->rowcnt[h];
+    board->rowcnt[h] = cnt;
+    if (cnt && h >= state->height) {
+        state->height = h + 1;
+    }
+
+    return p + (nib + 1) / 2;
+}
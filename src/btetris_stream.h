@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+
+#ifndef __TETRIS_STREAM__
+#define __TETRIS_STREAM__
+
+// Number of frames between keyframes
+#ifndef TETRIS_STREAM_KEYINT
+    #define TETRIS_STREAM_KEYINT 600
+#elif TETRIS_STREAM_KEYINT < 1
+    #error invalid keyframe interval, too small
+#endif
+
+// Bytes of a row's occupancy mask, one bit per column
+#define TETRIS_STREAM_MASK ((TETRIS_WIDTH + 7) / 8)
+
+// Largest possible frame, a keyframe with every row filled
+#define TETRIS_STREAM_MAX (32 + TETRIS_PP_SIZE + (TETRIS_HEIGHT+TETRIS_HEIGHT_BUFF) * (1 + TETRIS_STREAM_MASK + (TETRIS_WIDTH+1)/2))
+
+// Sections present in a frame, set in the frame's first byte. Sections follow in the order of their bits.
+typedef enum tetris_stream_sect {
+    TETRIS_STREAM_KEY   = 1 << 0,   // Keyframe, state is cleared before the frame is applied and every section follows
+    TETRIS_STREAM_FLAGS = 1 << 1,   // Game state flags, 1 byte
+    TETRIS_STREAM_MOVE  = 1 << 2,   // Falling tetromino moved without rotating, 1 byte of height and width change
+    TETRIS_STREAM_PIECE = 1 << 3,   // Falling tetromino, color, rotation and 4 positions
+    TETRIS_STREAM_QUEUE = 1 << 4,   // Piece preview, one color per nibble
+    TETRIS_STREAM_SCORE = 1 << 5,   // Level, lines and score change as a varint
+    TETRIS_STREAM_ROWS  = 1 << 6    // Changed rows of the playfield
+} tetris_stream_sect_t;
+
+
+// --- Stream Structures --- //
+
+/*
+ * State of a game as sent in a stream. The encoder keeps the state it last sent, and a decoder rebuilds the same state.
+ * Rows of the playfield are sent as a XOR of their occupancy, plus the color of every cell that became filled.
+ * A row byte with its top bit set is followed by the color of every filled cell instead, used when a filled cell
+ * changes color, like rows moved down by a line clear.
+ */
+typedef struct tetris_stream_state
+{
+    tetris_board_t  board;                      // Playfield and falling tetromino, can be drawn like a game's board
+    int8_t          ppreview[TETRIS_PP_SIZE];   // Piece preview, next tetromino first
+    int64_t         score;
+    int8_t          level;
+    int8_t          lines;                      // Lines cleared in this level
+    int8_t          flags;                      // Bit 0 isStarted, bit 1 isRunning, bit 2 isGameover
+    int8_t          height;                     // Number of rows up to the highest filled one
+    int8_t          valid;                      // Set once a keyframe has been applied
+} tetris_stream_state_t;
+
+// Encoder of one game's stream
+typedef struct tetris_stream
+{
+    tetris_stream_state_t   sent;   // State as of the last encoded frame
+    int32_t                 frame;  // Number of encoded frames
+    int32_t                 keyint; // Frames between keyframes
+    int32_t                 nextkey;// Frame of the next keyframe
+} tetris_stream_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Initializes an encoder, the first frame is a keyframe
+/// @param stream Stream object
+/// @param keyint Frames between keyframes, TETRIS_STREAM_KEYINT if 0 or less
+void tetris_stream_init(tetris_stream_t* stream, int32_t keyint);
+
+/// @brief Makes the next encoded frame a keyframe, for example when a spectator joins
+/// @param stream Stream object
+void tetris_stream_keyframe(tetris_stream_t* stream);
+
+/// @brief Encodes the changes of a game since the last frame. Changed rows are found by comparing rows
+/// up to the playfield height against the last sent state, so frames can be encoded at any rate.
+/// @param stream Stream object
+/// @param game Game object
+/// @param buf Output buffer, at least TETRIS_STREAM_MAX bytes
+/// @return Number of bytes written, 0 if nothing changed
+int32_t tetris_stream_encode(tetris_stream_t* stream, const tetris_game_t* game, uint8_t* buf);
+
+/// @brief Initializes a decoder state, frames are ignored until the next keyframe
+/// @param state State object
+void tetris_stream_state_init(tetris_stream_state_t* state);
+
+/// @brief Applies an encoded frame to a decoder state
+/// @param state State object
+/// @param buf Encoded frame
+/// @param len Length of the frame in bytes
+/// @return TETRIS_ERROR_INVALID_INPUT if the frame is malformed, the state then waits for the next keyframe.
+/// TETRIS_ERROR_NOT_STARTED if no keyframe was applied yet
+tetris_error_t tetris_stream_decode(tetris_stream_state_t* state, const uint8_t* buf, int32_t len);
+
+#endif
@@ -0,0 +1,248 @@
+#include "btetris_versus.h"
+
+// --- Function Declarations --- //
+
+/// @brief Lock callback of every player. Sends garbage for the lock, cancels incoming garbage and inserts the rest.
+/// @param game Game object
+/// @param state Player object
+/// @return TETRIS_ERROR_GAME_OVER if garbage pushed filled rows out of the playfield
+tetris_error_t tetris_versus_lock(tetris_game_t* game, void* state);
+
+/// @brief Points a player at the next player that is still alive
+/// @param match Match object
+/// @param player Player object
+void tetris_versus_retarget(tetris_versus_t* match, tetris_player_t* player);
+
+
+// --- Function Definitions --- //
+
+// Sets up a match between started games
+tetris_error_t tetris_versus_init(tetris_versus_t* match, tetris_game_t* const games[], int8_t count, uint64_t seed)
+{
+    // Error checking
+    if (!match || !games) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (count < 2 || count > TETRIS_VERSUS_PLAYERS) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (!games[i]) {
+            return TETRIS_ERROR_NULL_GAME;
+        }
+        if (!games[i]->board) {
+            return TETRIS_ERROR_NULL_BOARD;
+        }
+    }
+
+    match->count = count;
+    match->alive = count;
+    tetris_rng_seed(&match->rng, seed);
+
+    for (int8_t i = 0; i < count; i++)
+    {
+        tetris_player_t* player = &match->players[i];
+
+        player->game = games[i];
+        player->match = match;
+        player->idx = i;
+        player->alive = 1;
+        player->target = (i + 1) % count;
+        player->qhead = 0;
+        player->qlen = 0;
+        player->pending = 0;
+        player->sent = 0;
+        player->received = 0;
+
+        tetris_set_lockfunc(games[i], tetris_versus_lock, player);
+    }
+
+    return TETRIS_SUCCESS;
+}
+
+// Ticks the game of every player still alive
+tetris_error_t tetris_versus_tick(tetris_versus_t* match, uint64_t tmicro)
+{
+    if (!match) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+
+    for (int i = 0; i < match->count && match->alive > 1; i++)
+    {
+        tetris_player_t* player = &match->players[i];
+
+        if (!player->alive) {
+            continue;
+        }
+
+        if (tetris_tick(player->game, tmicro) == TETRIS_ERROR_GAME_OVER)
+        {
+            player->alive = 0;
+            match->alive--;
+
+            // Players attacking the loser move on to the next player
+            for (int j = 0; j < match->count; j++)
+            {
+                if (match->players[j].alive && match->players[j].target == i) {
+                    tetris_versus_retarget(match, &match->players[j]);
+                }
+            }
+        }
+    }
+
+    return (match->alive > 1) ? TETRIS_SUCCESS : TETRIS_ERROR_GAME_OVER;
+}
+
+// Finds the winner of a finished match
+int8_t tetris_versus_winner(const tetris_versus_t* match)
+{
+    if (!match || match->alive != 1) {
+        return -1;
+    }
+
+    for (int8_t i = 0; i < match->count; i++)
+    {
+        if (match->players[i].alive) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Queues garbage for the target of a player
+tetris_error_t tetris_versus_send(tetris_versus_t* match, int8_t from, int8_t lines)
+{
+    tetris_player_t* target;
+    tetris_garbage_t* last;
+    int8_t hole;
+
+    // Error checking
+    if (!match || from < 0 || from >= match->count || lines < 0) {
+        return TETRIS_ERROR_INVALID_INPUT;
+    }
+    if (lines == 0 || match->alive < 2) {
+        return TETRIS_SUCCESS;
+    }
+
+    target = &match->players[match->players[from].target];
+
+    // Map random number to [0, TETRIS_WIDTH) without division
+    hole = (int8_t)(((uint64_t)tetris_rng_next(&match->rng) * TETRIS_WIDTH) >> 32);
+
+    if (target->qlen < TETRIS_VERSUS_QUEUE)
+    {
+        target->queue[(target->qhead + target->qlen) % TETRIS_VERSUS_QUEUE] = (tetris_garbage_t){lines, hole};
+        target->qlen++;
+    }
+    else
+    {
+        // Queue is full, add the rows to the newest attack
+        last = &target->queue[(target->qhead + target->qlen - 1) % TETRIS_VERSUS_QUEUE];
+        last->lines = (last->lines > INT8_MAX - lines) ? INT8_MAX : last->lines + lines;
+    }
+
+    target->pending += lines;
+    match->players[from].sent += lines;
+
+    return TETRIS_SUCCESS;
+}
+
+// Calculates the garbage sent for a lock
+int8_t tetris_versus_attack(const tetris_clear_t* lclear)
+{
+    int attack;
+
+    if (!lclear || lclear->lines <= 0) {
+        return 0;
+    }
+
+    attack = TETRIS_VERSUS_CLEAR[lclear->tspin][lclear->lines];
+    attack += TETRIS_VERSUS_COMBO[(lclear->combo < 11) ? lclear->combo : 11];
+    if (lclear->pclear) {
+        attack += TETRIS_VERSUS_PCLEAR;
+    }
+
+    return (int8_t)attack;
+}
+
+// Lock callback of every player
+tetris_error_t tetris_versus_lock(tetris_game_t* game, void* state)
+{
+    tetris_player_t* player = state;
+    tetris_garbage_t* head;
+    int8_t attack, take, left;
+    int8_t over = 0;
+
+    // Own attack cancels incoming garbage first, the rest is sent
+    attack = tetris_versus_attack(&game->lclear);
+    while (attack > 0 && player->qlen > 0)
+    {
+        head = &player->queue[player->qhead];
+        take = (attack < head->lines) ? attack : head->lines;
+        head->lines -= take;
+        attack -= take;
+        player->pending -= take;
+
+        if (head->lines == 0)
+        {
+            player->qhead = (player->qhead + 1) % TETRIS_VERSUS_QUEUE;
+            player->qlen--;
+        }
+    }
+    tetris_versus_send(player->match, player->idx, attack);
+
+    // Garbage only rises after a lock that didn't clear rows
+    if (game->lclear.lines > 0) {
+        return TETRIS_SUCCESS;
+    }
+
+    left = TETRIS_VERSUS_CAP;
+    while (left > 0 && player->qlen > 0)
+    {
+        head = &player->queue[player->qhead];
+        take = (left < head->lines) ? left : head->lines;
+
+        over |= tetris_board_garbage(game->board, take, head->hole);
+
+        head->lines -= take;
+        left -= take;
+        player->pending -= take;
+        player->received += take;
+
+        if (head->lines == 0)
+        {
+            player->qhead = (player->qhead + 1) % TETRIS_VERSUS_QUEUE;
+            player->qlen--;
+        }
+    }
+
+    return over ? TETRIS_ERROR_GAME_OVER : TETRIS_SUCCESS;
+}
+
+// Points a player at the next player that is still alive
+void tetris_versus_retarget(tetris_versus_t* match, tetris_player_t* player)
+{
+    for (int i = 1; i < match->count; i++)
+    {
+        int8_t idx = (player->idx + i) % match->count;
+        if (match->players[idx].alive)
+        {
+            player->target = idx;
+            return;
+        }
+    }
+
+    player->target = player->idx;
+}
+
+// Garbage rows sent for clearing rows, indexed [tetris_tspin_t][Lines]
+const int8_t TETRIS_VERSUS_CLEAR[3][5] = {
+    {0, 0, 1, 2, 4},    // No T-spin
+    {0, 0, 1, 0, 0},    // T-spin mini
+    {0, 2, 4, 6, 0},    // T-spin
+};
+
+// Extra garbage rows for a combo, indexed [Combo]
+const int8_t TETRIS_VERSUS_COMBO[12] = {0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5};
@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include "btetris_board.h"
+#include "btetris_game.h"
+#include "btetris_rng.h"
+
+#ifndef __TETRIS_VERSUS__
+#define __TETRIS_VERSUS__
+
+// Maximum number of players in a match
+#ifndef TETRIS_VERSUS_PLAYERS
+    #define TETRIS_VERSUS_PLAYERS 4
+#elif TETRIS_VERSUS_PLAYERS < 2
+    #error invalid number of versus players, too small
+#elif TETRIS_VERSUS_PLAYERS > 64
+    #error invalid number of versus players, too large
+#endif
+
+// Number of attacks a player's garbage queue holds, attacks past that are merged into the last one
+#ifndef TETRIS_VERSUS_QUEUE
+    #define TETRIS_VERSUS_QUEUE 8
+#elif TETRIS_VERSUS_QUEUE < 1
+    #error invalid garbage queue size, too small
+#elif TETRIS_VERSUS_QUEUE > 64
+    #error invalid garbage queue size, too large
+#endif
+
+// Maximum number of garbage rows inserted after one lock, the rest stays queued
+#ifndef TETRIS_VERSUS_CAP
+    #define TETRIS_VERSUS_CAP 8
+#elif TETRIS_VERSUS_CAP < 1
+    #error invalid garbage cap, too small
+#endif
+
+
+// --- Versus Structures --- //
+
+// Rows of one attack, every row has its hole in the same column
+typedef struct tetris_garbage {
+    int8_t lines;   // Number of rows
+    int8_t hole;    // Empty column
+} tetris_garbage_t;
+
+typedef struct tetris_player
+{
+    tetris_game_t*          game;
+    struct tetris_versus*   match;
+    int8_t                  idx;        // Index in the match
+    int8_t                  alive;      // Cleared when the player's game is over
+    int8_t                  target;     // Player that receives this player's garbage
+
+    // Incoming garbage
+    tetris_garbage_t    queue[TETRIS_VERSUS_QUEUE];  // Ring buffer starting at qhead
+    int8_t              qhead;
+    int8_t              qlen;
+    int16_t             pending;    // Number of rows in queue
+
+    // Totals
+    int32_t sent;       // Rows sent to other players
+    int32_t received;   // Rows inserted into this player's playfield
+} tetris_player_t;
+
+/*
+ * Lines cleared by a player are sent to its target as garbage. Incoming garbage waits in the player's queue,
+ * it is canceled by the player's own attacks first and inserted after the next lock that doesn't clear rows.
+ * Hole columns come from the match's RNG, so a match only depends on its seed and the players' inputs.
+ */
+typedef struct tetris_versus
+{
+    tetris_player_t players[TETRIS_VERSUS_PLAYERS];
+    int8_t          count;  // Number of players
+    int8_t          alive;  // Number of players whose game isn't over
+    tetris_rng_t    rng;    // Garbage hole columns
+} tetris_versus_t;
+
+
+// --- Function Declarations --- //
+
+/// @brief Sets up a match between started games, each player targets the next one.
+/// Installs a lock callback on every game, see `tetris_set_lockfunc()`.
+/// @param match Match object
+/// @param games Games of the players
+/// @param count Number of players, [2:TETRIS_VERSUS_PLAYERS]
+/// @param seed Seed for garbage hole columns
+/// @return Error code
+tetris_error_t tetris_versus_init(tetris_versus_t* match, tetris_game_t* const games[], int8_t count, uint64_t seed);
+
+/// @brief Ticks the game of every player still alive
+/// @param match Match object
+/// @param tmicro Microseconds since the last tick
+/// @return TETRIS_ERROR_GAME_OVER once one or no player is left
+tetris_error_t tetris_versus_tick(tetris_versus_t* match, uint64_t tmicro);
+
+/// @brief Finds the winner of a finished match
+/// @param match Match object
+/// @return Index of the last player alive, -1 if the match isn't over or every player lost
+int8_t tetris_versus_winner(const tetris_versus_t* match);
+
+/// @brief Queues garbage for the target of a player
+/// @param match Match object
+/// @param from Index of the sending player
+/// @param lines Number of rows
+/// @return Error code
+tetris_error_t tetris_versus_send(tetris_versus_t* match, int8_t from, int8_t lines);
+
+/// @brief Calculates the garbage sent for a lock, from cleared rows, T-spins, combo and perfect clears
+/// @param lclear Result of the lock
+/// @return Number of garbage rows
+int8_t tetris_versus_attack(const tetris_clear_t* lclear);
+
+
+// --- Versus Tables --- //
+
+// Garbage rows sent for clearing rows, indexed [tetris_tspin_t][Lines]
+extern const int8_t TETRIS_VERSUS_CLEAR[3][5];
+
+// Extra garbage rows for a combo, indexed [Combo], combos past the end use the last value
+extern const int8_t TETRIS_VERSUS_COMBO[12];
+
+// Extra garbage rows for a perfect clear
+#define TETRIS_VERSUS_PCLEAR 10
+
+#endif